@@ -47,11 +47,16 @@ void matVecMult(Matrix A, Matrix B, Matrix C, int rows, int cols) {
 void matVecMultParallelInstruction(Matrix A, Matrix B, Matrix C, int rows, int cols){
   for(int i = 0; i < rows; i++){
     
-    //unroll 2 operations inside for loop
-    for (int k = 0; k < cols - 1; k += 2) {
-      C[k] += A[i * cols + k] * B[k];
-      C[k + 1] += A[i * cols + k + 1] * B[k+1];
+    //unroll 2 operations inside for loop; two independent sums so the adds can overlap
+    float sum0 = 0, sum1 = 0;
+    int k = 0;
+    for (; k < cols - 1; k += 2) {
+      sum0 += A[i * cols + k] * B[k];
+      sum1 += A[i * cols + k + 1] * B[k+1];
     }
+    //odd column count leaves one element
+    if (k < cols) sum0 += A[i * cols + k] * B[k];
+    C[i] += sum0 + sum1;
   }
 }
 
@@ -119,8 +124,8 @@ int main(int argc, char** argv) {
   for(int i = 0; i < 3; i++){
     int n, m, p = 1;
     Matrix A, B, C;
-    double t, time1, time2 = 0;
-    double t_exp1, t_exp2, t_exp3 = 0;
+    double t = 0, time1 = 0, time2 = 0;
+    double t_exp1 = 0, t_exp2 = 0, t_exp3 = 0;
     
     n = problemSizes[i];
     m = problemSizes[i];
@@ -0,0 +1,56 @@
+//the HW1 and HW2 matrix vector experiments, shared by the optimized harness and the roofline suite
+#include "baseline.h"
+
+//The unimproved control
+void matVecMult(Matrix A, Matrix B, Matrix C, int rows, int cols) {
+  int i, k;
+
+  for (k = 0; k < cols; k++)
+    for (i = 0; i < rows; i++)
+      C[i] += A[i * cols + k] * B[k];
+}
+
+//Experiment from HW1: Locality. We need to call our matrix in row major order or else we'll miss the cache
+//Result: major speedup
+void rowMajor(Matrix A, Matrix B, Matrix C, int rows, int cols){
+
+  for(int i = 0; i < rows; i++){
+    for(int k = 0; k < cols; k++){
+      C[i] += A[i*cols + k] * B[k];
+    }
+  }
+}
+
+//Experiment HW2: Weak Optimized. I theorize that using OpenMP on the row level will constitute a weak speedup
+//Results: 
+void WeakOpenMP(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads){
+  //initialize iterators outside threading for proper scope
+  int i = 0, k = 0;
+#pragma omp parallel for num_threads(numThreads) default(none) private(i,k) shared(A,B,C,rows,cols)
+  for(i = 0; i < rows; i++){
+    double localC = 0;
+    for(k = 0; k < cols; k++){
+      localC += A[i*cols + k] * B[k];
+    }
+
+    C[i] = localC;
+  }
+}
+
+//Experiment HW2: Strong Optimized. I theorize that using OpenMP on the column level will constitute a strong speedup
+//There are more opporuntities to take advantage of parallel ops the more often the threads are applied
+//Results:
+void StrongOpenMP(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads){
+  int i = 0, k = 0;
+
+  for(i = 0; i < rows; i++){
+    double rowTemp = 0;
+#pragma omp parallel for num_threads(numThreads) default(none) private(k) shared(A,B,i,rows,cols) reduction(+:rowTemp)
+    for(k = 0; k < cols; k++){
+      rowTemp += A[i*cols + k] * B[k];
+    }
+
+    //After threads rejoin due to reduction, can safely assign to C[i]
+    C[i] = rowTemp;
+  }
+}
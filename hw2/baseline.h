@@ -0,0 +1,17 @@
+#ifndef BASELINE_H
+#define BASELINE_H
+
+#include "matrix.h"
+
+//the original experiments, all C = A*B with A rows x cols. matVecMult and rowMajor add into C, the OpenMP ones
+//overwrite it
+//column order control, the HW1 starting point
+void matVecMult(Matrix A, Matrix B, Matrix C, int rows, int cols);
+//the same loop in row order
+void rowMajor(Matrix A, Matrix B, Matrix C, int rows, int cols);
+//rows split over threads
+void WeakOpenMP(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads);
+//each row's dot product split over threads
+void StrongOpenMP(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads);
+
+#endif
@@ -0,0 +1,168 @@
+//timing and machine ceilings for the roofline suite
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "bench.h"
+#include "matrix.h"
+#include "microtime.h"
+
+CacheSizes benchCacheSizes(void){
+  CacheSizes c = {(size_t)32 << 10, (size_t)1 << 20, (size_t)32 << 20};
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  long l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE), l2 = sysconf(_SC_LEVEL2_CACHE_SIZE), l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if(l1 > 0) c.l1 = l1;
+  if(l2 > 0) c.l2 = l2;
+  if(l3 > 0) c.l3 = l3;
+#endif
+  return c;
+}
+
+void benchFlush(const BenchRegion* regions, int numRegions){
+#if defined(__x86_64__) || defined(__i386__)
+  //clflush on just the kernel's own data costs far less than sweeping a buffer bigger than the last level cache
+  for(int r = 0; r < numRegions; r++){
+    const char* p = (const char*)regions[r].start;
+    for(size_t off = 0; off < regions[r].bytes; off += 64) _mm_clflush(p + off);
+    if(regions[r].bytes > 0) _mm_clflush(p + regions[r].bytes - 1);
+  }
+  _mm_mfence();
+#else
+  //no user level flush: stream twice the last level cache through a scratch buffer instead
+  (void)regions;
+  (void)numRegions;
+  static char* scratch = NULL;
+  static size_t scratchBytes = 0;
+  if(scratch == NULL){
+    scratchBytes = 2 * benchCacheSizes().l3;
+    scratch = (char*)malloc(scratchBytes);
+    if(scratch == NULL) return;
+  }
+  for(size_t off = 0; off < scratchBytes; off += 64) scratch[off]++;
+#endif
+}
+
+static int compareDouble(const void* a, const void* b){
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+BenchStats benchTime(void (*kernel)(void* arg), void* arg, const BenchRegion* flush, int numFlush){
+  for(int w = 0; w < BENCH_WARMUP; w++) kernel(arg);
+
+  //size warm samples from one call, which is warm by now
+  int calls = 1;
+  if(numFlush == 0){
+    double time1 = microtime();
+    kernel(arg);
+    double once = microtime() - time1;
+    if(once < BENCH_MIN_SAMPLE_US) calls = (once > 0) ? (int)(BENCH_MIN_SAMPLE_US / once) + 1 : 1000;
+  }
+
+  double samples[BENCH_REPS];
+  for(int r = 0; r < BENCH_REPS; r++){
+    if(numFlush > 0) benchFlush(flush, numFlush);
+    double time1 = microtime();
+    for(int c = 0; c < calls; c++) kernel(arg);
+    samples[r] = (microtime() - time1) / calls;
+  }
+  qsort(samples, BENCH_REPS, sizeof(double), compareDouble);
+  BenchStats s = {samples[BENCH_REPS / 2], samples[0], samples[BENCH_REPS - 1]};
+  return s;
+}
+
+typedef struct {
+  float *a, *b, *c;
+  size_t n;
+  int numThreads;
+} Triad;
+
+static void triadKernel(void* arg){
+  Triad* t = (Triad*)arg;
+  float *a = t->a, *b = t->b, *c = t->c;
+  size_t n = t->n;
+  const float s = 3.0f;
+#pragma omp parallel for num_threads(t->numThreads) schedule(static)
+  for(size_t i = 0; i < n; i++){
+    a[i] = b[i] + s * c[i];
+  }
+}
+
+double benchStream(size_t bytes, int numThreads){
+  size_t n = bytes / (3 * sizeof(float));
+  n = (n < 16) ? 16 : n & ~(size_t)15;
+  Triad t = {createMatrix((int)n, 1), createMatrix((int)n, 1), createMatrix((int)n, 1), n, numThreads};
+  double gbs = 0;
+  if(t.a != NULL && t.b != NULL && t.c != NULL){
+    //first touch under the same static split the kernel uses
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for(size_t i = 0; i < n; i++){
+      t.a[i] = 0;
+      t.b[i] = 1;
+      t.c[i] = 2;
+    }
+    BenchStats s = benchTime(triadKernel, &t, NULL, 0);
+    gbs = 3.0 * n * sizeof(float) / (s.min * 1e3);
+  }
+  freeMatrix(t.a);
+  freeMatrix(t.b);
+  freeMatrix(t.c);
+  return gbs;
+}
+
+//eight independent vectors of multiply adds per thread, enough to cover the FMA latency on two ports. the vector
+//extension compiles to the widest registers -march allows
+typedef float BenchVec __attribute__((vector_size(64)));
+#define BENCH_PEAK_ITERS 4096
+
+typedef struct {
+  int numThreads;
+  float sink;
+} Peak;
+
+static void peakKernel(void* arg){
+  Peak* p = (Peak*)arg;
+  float total = 0;
+#pragma omp parallel num_threads(p->numThreads) reduction(+:total)
+  {
+    BenchVec m, c, a0, a1, a2, a3, a4, a5, a6, a7;
+    float seed = (float)omp_get_thread_num();
+    for(int l = 0; l < 16; l++){
+      m[l] = 0.999999f;
+      c[l] = 1e-6f;
+      a0[l] = seed + l;
+    }
+    a1 = a0 + 1;
+    a2 = a0 + 2;
+    a3 = a0 + 3;
+    a4 = a0 + 4;
+    a5 = a0 + 5;
+    a6 = a0 + 6;
+    a7 = a0 + 7;
+    for(int it = 0; it < BENCH_PEAK_ITERS; it++){
+      a0 = a0 * m + c;
+      a1 = a1 * m + c;
+      a2 = a2 * m + c;
+      a3 = a3 * m + c;
+      a4 = a4 * m + c;
+      a5 = a5 * m + c;
+      a6 = a6 * m + c;
+      a7 = a7 * m + c;
+    }
+    BenchVec s = a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7;
+    for(int l = 0; l < 16; l++) total += s[l];
+  }
+  //keeps the chains from being optimized away
+  p->sink += total;
+}
+
+double benchPeakFlops(int numThreads){
+  Peak p = {numThreads, 0};
+  BenchStats s = benchTime(peakKernel, &p, NULL, 0);
+  double flops = 2.0 * 8 * 16 * BENCH_PEAK_ITERS * numThreads;
+  return flops / (s.min * 1e3);
+}
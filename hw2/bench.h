@@ -0,0 +1,42 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+
+//measurement helpers for the roofline suite. a timed point gets BENCH_WARMUP untimed calls, then BENCH_REPS samples
+//summarized by their median, which one descheduled or page faulting sample cannot move
+#define BENCH_WARMUP 2
+#define BENCH_REPS 11
+//warm samples repeat the kernel until they last this long, so microtime's 1us resolution stays under 1%
+#define BENCH_MIN_SAMPLE_US 200.0
+
+typedef struct {
+  size_t l1, l2, l3;   //data cache bytes per level
+} CacheSizes;
+
+//from sysconf, with typical sizes for any level it does not report
+CacheSizes benchCacheSizes(void);
+
+typedef struct {
+  const void* start;
+  size_t bytes;
+} BenchRegion;
+
+typedef struct {
+  double median, min, max;   //microseconds per kernel call
+} BenchStats;
+
+//writes back and evicts every cache line of the regions
+void benchFlush(const BenchRegion* regions, int numRegions);
+
+//times kernel(arg). with numFlush > 0 every sample is one call made right after flushing the regions, so it starts
+//from memory; otherwise samples run warm, back to back
+BenchStats benchTime(void (*kernel)(void* arg), void* arg, const BenchRegion* flush, int numFlush);
+
+//STREAM triad a = b + s*c over three arrays totalling about bytes; GB/s of the fastest sample, counting the two
+//reads and one write per element as STREAM does
+double benchStream(size_t bytes, int numThreads);
+//independent FMA chains on every thread with no memory traffic; GFLOP/s of the fastest sample
+double benchPeakFlops(int numThreads);
+
+#endif
@@ -0,0 +1,150 @@
+//GEMM-lite kernels. a block of GEMM_MR rows of A is swept in GEMM_KC column slices small enough to stay in L1;
+//each slice is used against every column chunk of B before moving on, and the micro-kernel keeps a GEMM_MR x
+//one-register tile of C in registers: per k it loads one register of B[k, j..] and broadcasts GEMM_MR values of A
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include <omp.h>
+#include "gemm.h"
+#include "gemv.h"
+
+//rows per micro-kernel tile (one accumulator register each) and the k slice length; 8 x 256 floats of A is 8KB
+#define GEMM_MR 8
+#define GEMM_KC 256
+//rows handed to a thread at a time
+#define GEMM_ROW_BLOCK 64
+
+typedef void (*gemmKernel)(const float* A, const float* B, float* C, int row0, int row1, int cols, int p);
+
+//C[i, j] += sum over k in [k0, k1) of A[i, k] B[k, j] for one row, plain C. used for leftover rows and by the
+//scalar kernel
+static void gemmRowScalar(const float* A, const float* B, float* C, int i, int k0, int k1, int cols, int p){
+  const float* a = A + (size_t)i * cols;
+  float* c = C + (size_t)i * p;
+  for(int k = k0; k < k1; k++){
+    float aik = a[k];
+    const float* b = B + (size_t)k * p;
+    for(int j = 0; j < p; j++){
+      c[j] += aik * b[j];
+    }
+  }
+}
+
+static void gemmRowsScalar(const float* A, const float* B, float* C, int row0, int row1, int cols, int p){
+  for(int k0 = 0; k0 < cols; k0 += GEMM_KC){
+    int k1 = (k0 + GEMM_KC < cols) ? k0 + GEMM_KC : cols;
+    for(int i = row0; i < row1; i++){
+      gemmRowScalar(A, B, C, i, k0, k1, cols, p);
+    }
+  }
+}
+
+//AVX2: 8 rows x 8 columns of C in registers; the last column chunk uses masked loads and stores
+__attribute__((target("avx2,fma")))
+static void gemmRowsAvx2(const float* A, const float* B, float* C, int row0, int row1, int cols, int p){
+  for(int k0 = 0; k0 < cols; k0 += GEMM_KC){
+    int k1 = (k0 + GEMM_KC < cols) ? k0 + GEMM_KC : cols;
+    int i = row0;
+    for(; i + GEMM_MR <= row1; i += GEMM_MR){
+      const float* a = A + (size_t)i * cols;
+      for(int j = 0; j < p; j += 8){
+        //lane l is active when j + l < p
+        __m256i m = _mm256_cmpgt_epi32(_mm256_set1_epi32(p - j), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        float* c = C + (size_t)i * p + j;
+        __m256 c0 = _mm256_maskload_ps(c, m), c1 = _mm256_maskload_ps(c + p, m);
+        __m256 c2 = _mm256_maskload_ps(c + 2 * p, m), c3 = _mm256_maskload_ps(c + 3 * p, m);
+        __m256 c4 = _mm256_maskload_ps(c + 4 * p, m), c5 = _mm256_maskload_ps(c + 5 * p, m);
+        __m256 c6 = _mm256_maskload_ps(c + 6 * p, m), c7 = _mm256_maskload_ps(c + 7 * p, m);
+        for(int k = k0; k < k1; k++){
+          __m256 b = _mm256_maskload_ps(B + (size_t)k * p + j, m);
+          c0 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + k), b, c0);
+          c1 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + cols + k), b, c1);
+          c2 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 2 * (size_t)cols + k), b, c2);
+          c3 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 3 * (size_t)cols + k), b, c3);
+          c4 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 4 * (size_t)cols + k), b, c4);
+          c5 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 5 * (size_t)cols + k), b, c5);
+          c6 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 6 * (size_t)cols + k), b, c6);
+          c7 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 7 * (size_t)cols + k), b, c7);
+        }
+        _mm256_maskstore_ps(c, m, c0);
+        _mm256_maskstore_ps(c + p, m, c1);
+        _mm256_maskstore_ps(c + 2 * p, m, c2);
+        _mm256_maskstore_ps(c + 3 * p, m, c3);
+        _mm256_maskstore_ps(c + 4 * p, m, c4);
+        _mm256_maskstore_ps(c + 5 * p, m, c5);
+        _mm256_maskstore_ps(c + 6 * p, m, c6);
+        _mm256_maskstore_ps(c + 7 * p, m, c7);
+      }
+    }
+    for(; i < row1; i++){
+      gemmRowScalar(A, B, C, i, k0, k1, cols, p);
+    }
+  }
+}
+
+//AVX-512: 8 rows x 16 columns of C in registers; the last column chunk is masked
+__attribute__((target("avx512f")))
+static void gemmRowsAvx512(const float* A, const float* B, float* C, int row0, int row1, int cols, int p){
+  for(int k0 = 0; k0 < cols; k0 += GEMM_KC){
+    int k1 = (k0 + GEMM_KC < cols) ? k0 + GEMM_KC : cols;
+    int i = row0;
+    for(; i + GEMM_MR <= row1; i += GEMM_MR){
+      const float* a = A + (size_t)i * cols;
+      for(int j = 0; j < p; j += 16){
+        __mmask16 m = (p - j >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (p - j)) - 1);
+        float* c = C + (size_t)i * p + j;
+        __m512 c0 = _mm512_maskz_loadu_ps(m, c), c1 = _mm512_maskz_loadu_ps(m, c + p);
+        __m512 c2 = _mm512_maskz_loadu_ps(m, c + 2 * p), c3 = _mm512_maskz_loadu_ps(m, c + 3 * p);
+        __m512 c4 = _mm512_maskz_loadu_ps(m, c + 4 * p), c5 = _mm512_maskz_loadu_ps(m, c + 5 * p);
+        __m512 c6 = _mm512_maskz_loadu_ps(m, c + 6 * p), c7 = _mm512_maskz_loadu_ps(m, c + 7 * p);
+        for(int k = k0; k < k1; k++){
+          __m512 b = _mm512_maskz_loadu_ps(m, B + (size_t)k * p + j);
+          c0 = _mm512_fmadd_ps(_mm512_set1_ps(a[k]), b, c0);
+          c1 = _mm512_fmadd_ps(_mm512_set1_ps(a[cols + k]), b, c1);
+          c2 = _mm512_fmadd_ps(_mm512_set1_ps(a[2 * (size_t)cols + k]), b, c2);
+          c3 = _mm512_fmadd_ps(_mm512_set1_ps(a[3 * (size_t)cols + k]), b, c3);
+          c4 = _mm512_fmadd_ps(_mm512_set1_ps(a[4 * (size_t)cols + k]), b, c4);
+          c5 = _mm512_fmadd_ps(_mm512_set1_ps(a[5 * (size_t)cols + k]), b, c5);
+          c6 = _mm512_fmadd_ps(_mm512_set1_ps(a[6 * (size_t)cols + k]), b, c6);
+          c7 = _mm512_fmadd_ps(_mm512_set1_ps(a[7 * (size_t)cols + k]), b, c7);
+        }
+        _mm512_mask_storeu_ps(c, m, c0);
+        _mm512_mask_storeu_ps(c + p, m, c1);
+        _mm512_mask_storeu_ps(c + 2 * p, m, c2);
+        _mm512_mask_storeu_ps(c + 3 * p, m, c3);
+        _mm512_mask_storeu_ps(c + 4 * p, m, c4);
+        _mm512_mask_storeu_ps(c + 5 * p, m, c5);
+        _mm512_mask_storeu_ps(c + 6 * p, m, c6);
+        _mm512_mask_storeu_ps(c + 7 * p, m, c7);
+      }
+    }
+    for(; i < row1; i++){
+      gemmRowScalar(A, B, C, i, k0, k1, cols, p);
+    }
+  }
+}
+
+void gemmLite(Matrix A, Matrix B, Matrix C, int rows, int cols, int p, int numThreads){
+  //a single vector has nothing to reuse A across; the GEMV kernel is built for that case
+  if(p == 1){
+    gemvSimd(A, B, C, rows, cols, numThreads);
+    return;
+  }
+  gemmKernel kernel;
+  switch(gemvSelectedIsa()){
+    case ISA_AVX512: kernel = gemmRowsAvx512; break;
+    case ISA_AVX2:   kernel = gemmRowsAvx2; break;
+    default:         kernel = gemmRowsScalar; break;
+  }
+  int numBlocks = (rows + GEMM_ROW_BLOCK - 1) / GEMM_ROW_BLOCK;
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+  for(int b = 0; b < numBlocks; b++){
+    int row0 = b * GEMM_ROW_BLOCK;
+    int row1 = (row0 + GEMM_ROW_BLOCK < rows) ? row0 + GEMM_ROW_BLOCK : rows;
+    //the kernels accumulate across k slices, so each thread clears its own rows of C first
+    memset(C + (size_t)row0 * p, 0, (size_t)(row1 - row0) * p * sizeof(C[0]));
+    kernel(A, B, C, row0, row1, cols, p);
+  }
+}
@@ -0,0 +1,11 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "matrix.h"
+
+//batched matrix vector product C = A*B for p right hand sides: A rows x cols, B cols x p, C rows x p, all row
+//major. every tile of A that is loaded is used for all p vectors, so the cost moves from streaming A toward FLOPs
+//as p grows. uses the instruction set gemvSimd picked
+void gemmLite(Matrix A, Matrix B, Matrix C, int rows, int cols, int p, int numThreads);
+
+#endif
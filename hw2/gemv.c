@@ -0,0 +1,226 @@
+//SIMD GEMV kernels. each call handles a block of rows: four rows at a time share every load of B, with two
+//independent FMA accumulators per row so eight chains are in flight to cover the FMA latency
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+#include <omp.h>
+#include "gemv.h"
+
+//rows handed to a kernel call; parallel work is split on these blocks
+#define GEMV_ROW_BLOCK 64
+
+//rows are lda floats apart and the first cols of each are used, so a kernel can run on a column slice of A
+typedef void (*gemvKernel)(const float* A, const float* B, float* C, int row0, int row1, int cols, int lda,
+                           int aligned);
+
+//plain C fallback with the same 4-row blocking
+static void gemvRowsScalar(const float* A, const float* B, float* C, int row0, int row1, int cols, int lda,
+                           int aligned){
+  (void)aligned;
+  int i = row0;
+  for(; i + 4 <= row1; i += 4){
+    const float* a0 = A + (size_t)i * lda;
+    const float* a1 = a0 + lda;
+    const float* a2 = a1 + lda;
+    const float* a3 = a2 + lda;
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for(int k = 0; k < cols; k++){
+      float b = B[k];
+      s0 += a0[k] * b;
+      s1 += a1[k] * b;
+      s2 += a2[k] * b;
+      s3 += a3[k] * b;
+    }
+    C[i] = s0;
+    C[i + 1] = s1;
+    C[i + 2] = s2;
+    C[i + 3] = s3;
+  }
+  for(; i < row1; i++){
+    const float* a = A + (size_t)i * lda;
+    float s = 0;
+    for(int k = 0; k < cols; k++){
+      s += a[k] * B[k];
+    }
+    C[i] = s;
+  }
+}
+
+//AVX2 + FMA, 8 floats per register
+__attribute__((target("avx2,fma")))
+static inline float hsum256(__m256 v){
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+//'aligned' is a literal at both call sites, so each gets its own copy with only aligned or only unaligned loads
+__attribute__((target("avx2,fma"), always_inline))
+static inline void gemv4Avx2(const float* A, const float* B, float* C, int i, int cols, int lda, const int aligned){
+  const float* a0 = A + (size_t)i * lda;
+  const float* a1 = a0 + lda;
+  const float* a2 = a1 + lda;
+  const float* a3 = a2 + lda;
+  __m256 s00 = _mm256_setzero_ps(), s01 = _mm256_setzero_ps();
+  __m256 s10 = _mm256_setzero_ps(), s11 = _mm256_setzero_ps();
+  __m256 s20 = _mm256_setzero_ps(), s21 = _mm256_setzero_ps();
+  __m256 s30 = _mm256_setzero_ps(), s31 = _mm256_setzero_ps();
+#define LOAD256(p) (aligned ? _mm256_load_ps(p) : _mm256_loadu_ps(p))
+  int k = 0;
+  for(; k + 16 <= cols; k += 16){
+    __m256 b0 = LOAD256(B + k), b1 = LOAD256(B + k + 8);
+    s00 = _mm256_fmadd_ps(LOAD256(a0 + k), b0, s00);
+    s01 = _mm256_fmadd_ps(LOAD256(a0 + k + 8), b1, s01);
+    s10 = _mm256_fmadd_ps(LOAD256(a1 + k), b0, s10);
+    s11 = _mm256_fmadd_ps(LOAD256(a1 + k + 8), b1, s11);
+    s20 = _mm256_fmadd_ps(LOAD256(a2 + k), b0, s20);
+    s21 = _mm256_fmadd_ps(LOAD256(a2 + k + 8), b1, s21);
+    s30 = _mm256_fmadd_ps(LOAD256(a3 + k), b0, s30);
+    s31 = _mm256_fmadd_ps(LOAD256(a3 + k + 8), b1, s31);
+  }
+#undef LOAD256
+  float c0 = hsum256(_mm256_add_ps(s00, s01));
+  float c1 = hsum256(_mm256_add_ps(s10, s11));
+  float c2 = hsum256(_mm256_add_ps(s20, s21));
+  float c3 = hsum256(_mm256_add_ps(s30, s31));
+  for(; k < cols; k++){
+    float b = B[k];
+    c0 += a0[k] * b;
+    c1 += a1[k] * b;
+    c2 += a2[k] * b;
+    c3 += a3[k] * b;
+  }
+  C[i] = c0;
+  C[i + 1] = c1;
+  C[i + 2] = c2;
+  C[i + 3] = c3;
+}
+
+__attribute__((target("avx2,fma")))
+static void gemvRowsAvx2(const float* A, const float* B, float* C, int row0, int row1, int cols, int lda,
+                         int aligned){
+  int i = row0;
+  for(; i + 4 <= row1; i += 4){
+    if(aligned) gemv4Avx2(A, B, C, i, cols, lda, 1);
+    else gemv4Avx2(A, B, C, i, cols, lda, 0);
+  }
+  gemvRowsScalar(A, B, C, i, row1, cols, lda, 0);
+}
+
+//AVX-512, 16 floats per register; the column tail is a masked load instead of a scalar loop
+__attribute__((target("avx512f"), always_inline))
+static inline void gemv4Avx512(const float* A, const float* B, float* C, int i, int cols, int lda,
+                               const int aligned){
+  const float* a0 = A + (size_t)i * lda;
+  const float* a1 = a0 + lda;
+  const float* a2 = a1 + lda;
+  const float* a3 = a2 + lda;
+  __m512 s00 = _mm512_setzero_ps(), s01 = _mm512_setzero_ps();
+  __m512 s10 = _mm512_setzero_ps(), s11 = _mm512_setzero_ps();
+  __m512 s20 = _mm512_setzero_ps(), s21 = _mm512_setzero_ps();
+  __m512 s30 = _mm512_setzero_ps(), s31 = _mm512_setzero_ps();
+#define LOAD512(p) (aligned ? _mm512_load_ps(p) : _mm512_loadu_ps(p))
+  int k = 0;
+  for(; k + 32 <= cols; k += 32){
+    __m512 b0 = LOAD512(B + k), b1 = LOAD512(B + k + 16);
+    s00 = _mm512_fmadd_ps(LOAD512(a0 + k), b0, s00);
+    s01 = _mm512_fmadd_ps(LOAD512(a0 + k + 16), b1, s01);
+    s10 = _mm512_fmadd_ps(LOAD512(a1 + k), b0, s10);
+    s11 = _mm512_fmadd_ps(LOAD512(a1 + k + 16), b1, s11);
+    s20 = _mm512_fmadd_ps(LOAD512(a2 + k), b0, s20);
+    s21 = _mm512_fmadd_ps(LOAD512(a2 + k + 16), b1, s21);
+    s30 = _mm512_fmadd_ps(LOAD512(a3 + k), b0, s30);
+    s31 = _mm512_fmadd_ps(LOAD512(a3 + k + 16), b1, s31);
+  }
+#undef LOAD512
+  //at most two more chunks of up to 16, the last one masked
+  for(; k < cols; k += 16){
+    __mmask16 m = (cols - k >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (cols - k)) - 1);
+    __m512 b = _mm512_maskz_loadu_ps(m, B + k);
+    s00 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a0 + k), b, s00);
+    s10 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a1 + k), b, s10);
+    s20 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a2 + k), b, s20);
+    s30 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a3 + k), b, s30);
+  }
+  C[i] = _mm512_reduce_add_ps(_mm512_add_ps(s00, s01));
+  C[i + 1] = _mm512_reduce_add_ps(_mm512_add_ps(s10, s11));
+  C[i + 2] = _mm512_reduce_add_ps(_mm512_add_ps(s20, s21));
+  C[i + 3] = _mm512_reduce_add_ps(_mm512_add_ps(s30, s31));
+}
+
+__attribute__((target("avx512f")))
+static void gemvRowsAvx512(const float* A, const float* B, float* C, int row0, int row1, int cols, int lda,
+                           int aligned){
+  int i = row0;
+  for(; i + 4 <= row1; i += 4){
+    if(aligned) gemv4Avx512(A, B, C, i, cols, lda, 1);
+    else gemv4Avx512(A, B, C, i, cols, lda, 0);
+  }
+  gemvRowsScalar(A, B, C, i, row1, cols, lda, 0);
+}
+
+static gemvKernel selectedKernel = NULL;
+static gemvIsa selectedIsa = ISA_SCALAR;
+static const char* selectedName = "none";
+
+//resolve the kernel once; GEMV_ISA can force a narrower one for comparison
+static void gemvSelect(void){
+  const char* force = getenv("GEMV_ISA");
+  __builtin_cpu_init();
+  int has512 = __builtin_cpu_supports("avx512f");
+  int has2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+  if(force && strcmp(force, "scalar") == 0){
+    has512 = has2 = 0;
+  }else if(force && strcmp(force, "avx2") == 0){
+    has512 = 0;
+  }
+
+  if(has512){
+    selectedKernel = gemvRowsAvx512;
+    selectedIsa = ISA_AVX512;
+    selectedName = "avx512";
+  }else if(has2){
+    selectedKernel = gemvRowsAvx2;
+    selectedIsa = ISA_AVX2;
+    selectedName = "avx2";
+  }else{
+    selectedKernel = gemvRowsScalar;
+    selectedIsa = ISA_SCALAR;
+    selectedName = "scalar";
+  }
+}
+
+gemvIsa gemvSelectedIsa(void){
+  if(selectedKernel == NULL) gemvSelect();
+  return selectedIsa;
+}
+
+const char* gemvIsaName(void){
+  if(selectedKernel == NULL) gemvSelect();
+  return selectedName;
+}
+
+void gemvSimd(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads){
+  if(selectedKernel == NULL) gemvSelect();
+  gemvKernel kernel = selectedKernel;
+  //aligned loads need every row start and B on a 64 byte boundary
+  int aligned = ((uintptr_t)A % 64 == 0) && ((uintptr_t)B % 64 == 0) && (cols % 16 == 0);
+  int numBlocks = (rows + GEMV_ROW_BLOCK - 1) / GEMV_ROW_BLOCK;
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+  for(int b = 0; b < numBlocks; b++){
+    int row0 = b * GEMV_ROW_BLOCK;
+    int row1 = (row0 + GEMV_ROW_BLOCK < rows) ? row0 + GEMV_ROW_BLOCK : rows;
+    kernel(A, B, C, row0, row1, cols, cols, aligned);
+  }
+}
+
+void gemvBlock(const float* A, const float* B, float* C, int row0, int row1, int cols, int lda){
+  if(selectedKernel == NULL) gemvSelect();
+  int aligned = ((uintptr_t)A % 64 == 0) && ((uintptr_t)B % 64 == 0) && (lda % 16 == 0);
+  selectedKernel(A, B, C, row0, row1, cols, lda, aligned);
+}
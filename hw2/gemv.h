@@ -0,0 +1,19 @@
+#ifndef GEMV_H
+#define GEMV_H
+
+#include "matrix.h"
+
+//register-blocked SIMD matrix vector product C = A*B (A rows x cols, B cols x 1). the instruction set is picked
+//at runtime from what the cpu supports (AVX-512, AVX2+FMA, else scalar); GEMV_ISA=avx512|avx2|scalar overrides it
+typedef enum { ISA_SCALAR, ISA_AVX2, ISA_AVX512 } gemvIsa;
+
+void gemvSimd(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads);
+//serial kernel on one block: C[i] = sum over k < cols of A[i*lda + k] B[k] for row0 <= i < row1. A and B may
+//point into the middle of larger arrays, so a caller can split the columns as well as the rows. the instruction set
+//is picked lazily and without locking, so callers that run it on several threads resolve it first with
+//gemvSelectedIsa()
+void gemvBlock(const float* A, const float* B, float* C, int row0, int row1, int cols, int lda);
+gemvIsa gemvSelectedIsa(void);
+const char* gemvIsaName(void);
+
+#endif
@@ -0,0 +1,86 @@
+//2D partitioned GEMV. splitting only rows leaves threads idle when A is short and wide; splitting every row's dot
+//product (StrongOpenMP) pays a fork, join and reduction per row. here each thread owns one block of a grid, runs
+//the serial SIMD kernel on it, and the column partials are combined once at the end
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "gemv2d.h"
+#include "gemv.h"
+
+void gemv2DGrid(int rows, int cols, int numThreads, int* gridRows, int* gridCols){
+  if(numThreads < 1) numThreads = 1;
+  //score each factorization by how close its blocks come to the minimum height and width (1 once both are met).
+  //ties go to more block rows: they cost nothing extra, while block columns add a partial vector each
+  int best = 1;
+  double bestScore = -1;
+  for(int pr = 1; pr <= numThreads; pr++){
+    if(numThreads % pr != 0) continue;
+    int pc = numThreads / pr;
+    double height = (double)((rows + pr - 1) / pr) / GEMV2D_MIN_ROWS;
+    double width = (double)(cols / pc) / GEMV2D_MIN_COLS;
+    double score = (height < width) ? height : width;
+    if(score > 1) score = 1;
+    if(score >= bestScore){
+      best = pr;
+      bestScore = score;
+    }
+  }
+  *gridRows = best;
+  *gridCols = numThreads / best;
+}
+
+void gemv2D(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads){
+  //written by one thread inside the region once the real team size is known
+  int gridRows = 1, gridCols = 1;
+  float* partial = NULL;
+  //gemvBlock picks its kernel on first use; do that here rather than racing on it from every thread
+  gemvSelectedIsa();
+
+#pragma omp parallel num_threads(numThreads)
+  {
+    int tid = omp_get_thread_num();
+    int nt = omp_get_num_threads();
+#pragma omp single
+    {
+      gemv2DGrid(rows, cols, nt, &gridRows, &gridCols);
+      if(gridCols > 1){
+        partial = (float*)malloc((size_t)(gridCols - 1) * rows * sizeof(float));
+        if(partial == NULL){
+          fprintf(stderr, "gemv2D: partial vector allocation failed, using one block column\n");
+          gridRows = nt;
+          gridCols = 1;
+        }
+      }
+    }
+    //the single's implicit barrier publishes the grid to every thread
+
+    //gridRows * gridCols == nt, so every thread owns exactly one block
+    int g = tid / gridCols, h = tid % gridCols;
+    int row0 = (int)((long)rows * g / gridRows);
+    int row1 = (int)((long)rows * (g + 1) / gridRows);
+    //column cuts on 16 float boundaries keep B and A slices 64 byte aligned when the rows are
+    int col0 = (h == 0) ? 0 : (int)((long)cols * h / gridCols) & ~15;
+    int col1 = (h == gridCols - 1) ? cols : (int)((long)cols * (h + 1) / gridCols) & ~15;
+    //block column 0 writes C directly; the others write their own partial vector
+    float* out = (h == 0) ? C : partial + (size_t)(h - 1) * rows;
+    if(col1 > col0){
+      gemvBlock(A + col0, B + col0, out, row0, row1, col1 - col0, cols);
+    }else{
+      for(int i = row0; i < row1; i++) out[i] = 0;
+    }
+
+    if(gridCols > 1){
+#pragma omp barrier
+      //every thread adds up a contiguous range of rows across the partial vectors
+#pragma omp for schedule(static)
+      for(int i = 0; i < rows; i++){
+        float s = C[i];
+        for(int h = 1; h < gridCols; h++){
+          s += partial[(size_t)(h - 1) * rows + i];
+        }
+        C[i] = s;
+      }
+    }
+  }
+  free(partial);
+}
@@ -0,0 +1,21 @@
+#ifndef GEMV2D_H
+#define GEMV2D_H
+
+#include "matrix.h"
+
+//GEMV over a gridRows x gridCols grid of blocks of A, one block per thread, in a single parallel region. threads
+//in the same block row write their partial sums to separate vectors, which all threads then add up row range by
+//row range, so no atomics or per row reductions are needed. works for any rows x cols shape
+void gemv2D(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads);
+
+//the grid gemv2D uses: a factorization of the thread count whose blocks are at least GEMV2D_MIN_ROWS tall and
+//GEMV2D_MIN_COLS wide, with as many block rows as possible. when no factorization meets both, the one whose blocks
+//come closest to them
+void gemv2DGrid(int rows, int cols, int numThreads, int* gridRows, int* gridCols);
+
+//fewer rows than this per block and the 4 row kernel runs mostly on its scalar tail
+#define GEMV2D_MIN_ROWS 16
+//narrower blocks spend more on their partial vector than on the product; column cuts also round to 16 floats
+#define GEMV2D_MIN_COLS 64
+
+#endif
@@ -0,0 +1,78 @@
+//transposed GEMV. y[j] = sum over i of A[i, j] x[i] walks a column of A per output, which is the access pattern
+//the unoptimized control suffers from. here the loop order is flipped: every row i adds x[i] * A[i, :] to y, so A
+//streams in storage order and only y is revisited. y is cut into column slices of GEMVT_COL_BLOCK so the slice
+//being updated stays in L1 while all of a thread's rows pass over it
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "gemvt.h"
+
+//4096 floats is 16KB of y, half of a typical L1
+#define GEMVT_COL_BLOCK 4096
+
+//y[j0..j1) += sum over i in [row0, row1) of x[i] A[i, j0..j1). four rows per pass over the slice cut the loads
+//and stores of y by four; the inner loop is left to the compiler to vectorize
+static void gemvtRows(const float* A, const float* x, float* restrict y, int row0, int row1, int cols, int j0, int j1){
+  int i = row0;
+  for(; i + 4 <= row1; i += 4){
+    const float* restrict a0 = A + (size_t)i * cols;
+    const float* restrict a1 = a0 + cols;
+    const float* restrict a2 = a1 + cols;
+    const float* restrict a3 = a2 + cols;
+    float x0 = x[i], x1 = x[i + 1], x2 = x[i + 2], x3 = x[i + 3];
+    for(int j = j0; j < j1; j++){
+      y[j] += x0 * a0[j] + x1 * a1[j] + x2 * a2[j] + x3 * a3[j];
+    }
+  }
+  for(; i < row1; i++){
+    const float* restrict a = A + (size_t)i * cols;
+    float xi = x[i];
+    for(int j = j0; j < j1; j++){
+      y[j] += xi * a[j];
+    }
+  }
+}
+
+void gemvTranspose(Matrix A, Matrix x, Matrix y, int rows, int cols, int numThreads){
+  if(numThreads < 1) numThreads = 1;
+  //thread 0 accumulates straight into y; the others get a private partial vector each
+  float* scratch = NULL;
+  if(numThreads > 1){
+    scratch = (float*)malloc((size_t)(numThreads - 1) * cols * sizeof(float));
+    if(scratch == NULL){
+      fprintf(stderr, "gemvTranspose: partial vector allocation failed, running on one thread\n");
+      numThreads = 1;
+    }
+  }
+
+#pragma omp parallel num_threads(numThreads)
+  {
+    int tid = omp_get_thread_num();
+    int nt = omp_get_num_threads();
+    float* part = (tid == 0) ? y : scratch + (size_t)(tid - 1) * cols;
+    memset(part, 0, (size_t)cols * sizeof(float));
+
+    //contiguous row ranges, same split as schedule(static)
+    int row0 = (int)((long)rows * tid / nt);
+    int row1 = (int)((long)rows * (tid + 1) / nt);
+    for(int j0 = 0; j0 < cols; j0 += GEMVT_COL_BLOCK){
+      int j1 = (j0 + GEMVT_COL_BLOCK < cols) ? j0 + GEMVT_COL_BLOCK : cols;
+      gemvtRows(A, x, part, row0, row1, cols, j0, j1);
+    }
+
+    //tree reduction: at stride s, thread t (a multiple of 2s) adds in the partial of thread t + s. log2(nt)
+    //rounds, each separated by a barrier, and every partial is read exactly once
+    for(int s = 1; s < nt; s *= 2){
+#pragma omp barrier
+      if(tid % (2 * s) == 0 && tid + s < nt){
+        float* restrict dst = part;
+        const float* restrict src = scratch + (size_t)(tid + s - 1) * cols;
+        for(int j = 0; j < cols; j++){
+          dst[j] += src[j];
+        }
+      }
+    }
+  }
+  free(scratch);
+}
@@ -0,0 +1,11 @@
+#ifndef GEMVT_H
+#define GEMVT_H
+
+#include "matrix.h"
+
+//transposed matrix vector product y = A^T x without forming A^T: A is rows x cols row major, x has rows entries
+//and y has cols. A is still read row by row; each thread sums its share of rows into a private copy of y, one
+//cache sized column slice at a time, and the copies are added pairwise in a tree at the end
+void gemvTranspose(Matrix A, Matrix x, Matrix y, int rows, int cols, int numThreads);
+
+#endif
@@ -0,0 +1,275 @@
+//memory mapped matrix files and a GEMV that streams them. the mapping is advised sequential so the kernel reads
+//ahead aggressively and frees behind, and a prefetch thread touches every page of the next band while the current
+//one is multiplied, so page faults and disk reads overlap with the arithmetic instead of stalling it
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include "matfile.h"
+#include "gemv.h"
+
+//rows handed to a kernel call inside a band
+#define MATFILE_ROW_BLOCK 64
+
+int matrixFileWrite(const char* path, int rows, int cols, int blockRows,
+                    void (*fillRow)(float* row, int i, int cols, void* arg), void* arg){
+  //matrixFileOpen rejects what this would write for an empty row
+  if(rows < 0 || cols < 1){
+    fprintf(stderr, "%s: a matrix file needs at least one column\n", path);
+    return -1;
+  }
+  MatrixFileHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, MATFILE_MAGIC, sizeof(h.magic));
+  h.version = MATFILE_VERSION;
+  h.headerBytes = sizeof(h);
+  h.rows = rows;
+  h.cols = cols;
+  h.rowStride = ((uint64_t)cols + 15) & ~(uint64_t)15;
+  h.blockRows = (blockRows > 0) ? blockRows : 0;
+  h.numBlocks = (blockRows > 0) ? ((uint64_t)rows + blockRows - 1) / blockRows : 0;
+  h.indexOffset = sizeof(h);
+  uint64_t indexEnd = h.indexOffset + h.numBlocks * sizeof(MatrixFileBlock);
+  h.dataOffset = (indexEnd + MATFILE_PAGE - 1) / MATFILE_PAGE * MATFILE_PAGE;
+  size_t rowBytes = h.rowStride * sizeof(float);
+
+  FILE* file = fopen(path, "wb");
+  if(file == NULL){
+    fprintf(stderr, "Could not open file %s for writing\n", path);
+    return -1;
+  }
+  //256 rows per write, or fewer for very wide rows
+  int bufRows = 256;
+  while(bufRows > 1 && (size_t)bufRows * rowBytes > ((size_t)16 << 20)) bufRows /= 2;
+  float* buf = (float*)calloc((size_t)bufRows, rowBytes);
+  char* pad = (char*)calloc(1, MATFILE_PAGE);
+  int ok = (buf != NULL && pad != NULL);
+
+  ok = ok && fwrite(&h, sizeof(h), 1, file) == 1;
+  for(uint64_t b = 0; ok && b < h.numBlocks; b++){
+    MatrixFileBlock e;
+    e.firstRow = b * h.blockRows;
+    e.rows = (e.firstRow + h.blockRows <= h.rows) ? h.blockRows : h.rows - e.firstRow;
+    e.offset = h.dataOffset + e.firstRow * rowBytes;
+    ok = fwrite(&e, sizeof(e), 1, file) == 1;
+  }
+  if(ok && h.dataOffset > indexEnd) ok = fwrite(pad, h.dataOffset - indexEnd, 1, file) == 1;
+  for(int i = 0; ok && i < rows; i += bufRows){
+    int n = (i + bufRows <= rows) ? bufRows : rows - i;
+    for(int r = 0; r < n; r++){
+      //the padding floats stay zero from calloc
+      fillRow(buf + (size_t)r * h.rowStride, i + r, cols, arg);
+    }
+    ok = fwrite(buf, rowBytes, n, file) == (size_t)n;
+  }
+  free(buf);
+  free(pad);
+  if(fclose(file) != 0) ok = 0;
+  if(!ok){
+    fprintf(stderr, "Could not write matrix file %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+MatrixFile* matrixFileOpen(const char* path){
+  int fd = open(path, O_RDONLY);
+  if(fd < 0){
+    fprintf(stderr, "Could not open file %s for reading\n", path);
+    return NULL;
+  }
+  struct stat st;
+  MatrixFileHeader h;
+  if(fstat(fd, &st) != 0 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+     memcmp(h.magic, MATFILE_MAGIC, sizeof(h.magic)) != 0 || h.version != MATFILE_VERSION){
+    fprintf(stderr, "%s: not a matrix file\n", path);
+    close(fd);
+    return NULL;
+  }
+  //bound every field before it is multiplied: rows and cols fit an int, rows hold at least one column and are
+  //padded to at most the next 16 floats as matrixFileWrite does, and the data has to fit in the file
+  uint64_t rowBytes = h.rowStride * sizeof(float);
+  uint64_t size = (uint64_t)st.st_size;
+  if(h.rows > 0x7fffffff || h.cols == 0 || h.cols > 0x7fffffff || h.rowStride < h.cols ||
+     h.rowStride > h.cols + 15 || h.rowStride % 16 != 0 || h.dataOffset % MATFILE_PAGE != 0 || h.dataOffset > size ||
+     h.rows > (size - h.dataOffset) / rowBytes){
+    fprintf(stderr, "%s: header does not match the file\n", path);
+    close(fd);
+    return NULL;
+  }
+  //an index has to have one entry per block of blockRows rows, sit between the header and the data, and be
+  //aligned for reading in place
+  if(h.numBlocks > 0 &&
+     (h.blockRows == 0 || h.blockRows > 0x7fffffff || h.numBlocks != (h.rows + h.blockRows - 1) / h.blockRows ||
+      h.indexOffset < sizeof(h) || h.indexOffset % sizeof(uint64_t) != 0 || h.indexOffset > h.dataOffset ||
+      h.numBlocks > (h.dataOffset - h.indexOffset) / sizeof(MatrixFileBlock))){
+    fprintf(stderr, "%s: row block index does not match the header\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  MatrixFile* F = (MatrixFile*)calloc(1, sizeof(MatrixFile));
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if(F == NULL || map == MAP_FAILED){
+    fprintf(stderr, "%s: could not map the file\n", path);
+    free(F);
+    if(map != MAP_FAILED) munmap(map, st.st_size);
+    close(fd);
+    return NULL;
+  }
+  F->fd = fd;
+  F->map = (const char*)map;
+  F->mapBytes = st.st_size;
+  F->header = h;
+  F->index = (h.numBlocks > 0) ? (const MatrixFileBlock*)(F->map + h.indexOffset) : NULL;
+  //gemvMapped reads a band of several blocks from its first entry's offset, so the blocks have to be laid out
+  //back to back exactly where matrixFileWrite puts them
+  for(uint64_t b = 0; b < h.numBlocks; b++){
+    const MatrixFileBlock* e = F->index + b;
+    uint64_t firstRow = b * h.blockRows;
+    uint64_t rows = (firstRow + h.blockRows <= h.rows) ? h.blockRows : h.rows - firstRow;
+    if(e->firstRow != firstRow || e->rows != rows || e->offset != h.dataOffset + firstRow * rowBytes){
+      fprintf(stderr, "%s: bad row block index entry %lu\n", path, (unsigned long)b);
+      matrixFileClose(F);
+      return NULL;
+    }
+  }
+  //one pass front to back: larger readahead, and pages behind the reader can be dropped early
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  return F;
+}
+
+void matrixFileClose(MatrixFile* F){
+  if(F == NULL) return;
+  munmap((void*)F->map, F->mapBytes);
+  close(F->fd);
+  free(F);
+}
+
+void matrixFileEvict(MatrixFile* F){
+  //only clean, unmapped pages can be dropped: flush a freshly written file and release the mapping's hold first
+  fdatasync(F->fd);
+  madvise((void*)F->map, F->mapBytes, MADV_DONTNEED);
+  posix_fadvise(F->fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+typedef struct {
+  int firstRow, rows;
+  const char* start;
+  size_t bytes;
+} Band;
+
+//state shared with the prefetch thread: it may run up to MATFILE_PREFETCH_AHEAD bands past the one being used
+#define MATFILE_PREFETCH_AHEAD 1
+
+typedef struct {
+  const Band* bands;
+  int numBands;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  int ready;      //bands [0, ready) are faulted in
+  int consumed;   //bands [0, consumed) are finished
+} Prefetcher;
+
+//asks the kernel to start reading a band without waiting for it
+static void bandWillNeed(const Band* band){
+  uintptr_t pageStart = (uintptr_t)band->start & ~(uintptr_t)(MATFILE_PAGE - 1);
+  madvise((void*)pageStart, (uintptr_t)band->start + band->bytes - pageStart, MADV_WILLNEED);
+}
+
+static void* prefetchMain(void* p){
+  Prefetcher* pf = (Prefetcher*)p;
+  volatile char sink = 0;
+  if(pf->numBands > 0) bandWillNeed(pf->bands);
+  for(int b = 0; b < pf->numBands; b++){
+    pthread_mutex_lock(&pf->lock);
+    while(b > pf->consumed + MATFILE_PREFETCH_AHEAD) pthread_cond_wait(&pf->changed, &pf->lock);
+    pthread_mutex_unlock(&pf->lock);
+
+    //queue the reads for the band after this one first, so the disk never idles between bands, then take this
+    //band's faults here instead of in the GEMV threads
+    if(b + 1 < pf->numBands) bandWillNeed(pf->bands + b + 1);
+    const Band* band = pf->bands + b;
+    uintptr_t pageStart = (uintptr_t)band->start & ~(uintptr_t)(MATFILE_PAGE - 1);
+#ifdef MADV_POPULATE_READ
+    //one call maps the whole band; older kernels reject it and fall through to touching each page
+    if(madvise((void*)pageStart, (uintptr_t)band->start + band->bytes - pageStart, MADV_POPULATE_READ) != 0)
+#endif
+    for(size_t off = 0; off < band->bytes; off += MATFILE_PAGE){
+      sink += band->start[off];
+    }
+
+    pthread_mutex_lock(&pf->lock);
+    pf->ready = b + 1;
+    pthread_cond_broadcast(&pf->changed);
+    pthread_mutex_unlock(&pf->lock);
+  }
+  (void)sink;
+  return NULL;
+}
+
+void gemvMapped(MatrixFile* F, Matrix B, Matrix C, size_t bandBytes, int numThreads){
+  const MatrixFileHeader* h = &F->header;
+  int rows = (int)h->rows, cols = (int)h->cols, stride = (int)h->rowStride;
+  size_t rowBytes = (size_t)stride * sizeof(float);
+  if(bandBytes == 0) bandBytes = MATFILE_BAND_BYTES;
+  int bandRows = (bandBytes / rowBytes > 0) ? (int)(bandBytes / rowBytes) : 1;
+  //with an index, bands are whole blocks and are located through it
+  if(F->index != NULL){
+    int blocksPerBand = (bandRows / (int)h->blockRows > 0) ? bandRows / (int)h->blockRows : 1;
+    bandRows = blocksPerBand * (int)h->blockRows;
+  }
+  int numBands = (rows + bandRows - 1) / bandRows;
+  Band* bands = (Band*)malloc(((size_t)numBands + 1) * sizeof(Band));
+  if(bands == NULL){
+    fprintf(stderr, "gemvMapped: allocation failed\n");
+    return;
+  }
+  for(int b = 0; b < numBands; b++){
+    bands[b].firstRow = b * bandRows;
+    bands[b].rows = ((size_t)bands[b].firstRow + bandRows <= (size_t)rows) ? bandRows : rows - bands[b].firstRow;
+    size_t offset = (F->index != NULL) ? F->index[(size_t)bands[b].firstRow / h->blockRows].offset
+                                       : h->dataOffset + (size_t)bands[b].firstRow * rowBytes;
+    bands[b].start = F->map + offset;
+    bands[b].bytes = (size_t)bands[b].rows * rowBytes;
+  }
+
+  //gemvBlock picks its kernel on first use; do that here rather than racing on it from every thread
+  gemvSelectedIsa();
+  Prefetcher pf = {bands, numBands, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0};
+  pthread_t thread;
+  int threaded = (pthread_create(&thread, NULL, prefetchMain, &pf) == 0);
+  if(!threaded) pf.ready = numBands;
+
+  for(int b = 0; b < numBands; b++){
+    pthread_mutex_lock(&pf.lock);
+    while(pf.ready <= b) pthread_cond_wait(&pf.changed, &pf.lock);
+    pthread_mutex_unlock(&pf.lock);
+
+    const float* A = (const float*)bands[b].start;
+    float* Cb = C + bands[b].firstRow;
+    int n = bands[b].rows;
+    int numBlocks = (n + MATFILE_ROW_BLOCK - 1) / MATFILE_ROW_BLOCK;
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for(int k = 0; k < numBlocks; k++){
+      int row0 = k * MATFILE_ROW_BLOCK;
+      int row1 = (row0 + MATFILE_ROW_BLOCK < n) ? row0 + MATFILE_ROW_BLOCK : n;
+      gemvBlock(A, B, Cb, row0, row1, cols, stride);
+    }
+
+    pthread_mutex_lock(&pf.lock);
+    pf.consumed = b + 1;
+    pthread_cond_broadcast(&pf.changed);
+    pthread_mutex_unlock(&pf.lock);
+  }
+
+  if(threaded) pthread_join(thread, NULL);
+  pthread_mutex_destroy(&pf.lock);
+  pthread_cond_destroy(&pf.changed);
+  free(bands);
+}
@@ -0,0 +1,59 @@
+#ifndef MATFILE_H
+#define MATFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "matrix.h"
+
+//binary matrix file, little endian:
+//  header | optional row block index | zero padding to MATFILE_PAGE | rows
+//each row is rowStride floats (cols rounded up to 16, zero padded), so with the page aligned data offset every row
+//of the mapped file starts on a 64 byte boundary and the aligned GEMV loads apply. the index lists where each block
+//of blockRows rows starts, so a reader can seek to a band without knowing the layout rules
+#define MATFILE_MAGIC "HW2MATRX"
+#define MATFILE_VERSION 1
+#define MATFILE_PAGE 4096
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerBytes;
+  uint64_t rows, cols;
+  uint64_t rowStride;    //floats from one row start to the next
+  uint64_t dataOffset;   //bytes, multiple of MATFILE_PAGE
+  uint64_t blockRows;    //rows per index entry, 0 when there is no index
+  uint64_t numBlocks;
+  uint64_t indexOffset;  //bytes; numBlocks MatrixFileBlock entries
+} MatrixFileHeader;
+
+typedef struct {
+  uint64_t offset;       //bytes from the start of the file
+  uint64_t firstRow;
+  uint64_t rows;
+} MatrixFileBlock;
+
+typedef struct {
+  int fd;
+  const char* map;
+  size_t mapBytes;
+  MatrixFileHeader header;
+  const MatrixFileBlock* index;   //NULL when the file has none
+} MatrixFile;
+
+//writes the file one buffer of rows at a time from fillRow, so the matrix never has to fit in memory. blockRows 0
+//writes no index. returns 0, or -1 after a message on stderr
+int matrixFileWrite(const char* path, int rows, int cols, int blockRows,
+                    void (*fillRow)(float* row, int i, int cols, void* arg), void* arg);
+
+//maps the whole file read only; NULL (after a message on stderr) if it is missing, truncated or not this format
+MatrixFile* matrixFileOpen(const char* path);
+void matrixFileClose(MatrixFile* F);
+//drops the file's pages from the page cache, so the next pass reads from disk
+void matrixFileEvict(MatrixFile* F);
+
+//C = A*B streaming the mapped A in row bands of about bandBytes (0 picks MATFILE_BAND_BYTES). a helper thread
+//faults in the band after the current one while the GEMV threads work on it
+#define MATFILE_BAND_BYTES ((size_t)32 << 20)
+void gemvMapped(MatrixFile* F, Matrix B, Matrix C, size_t bandBytes, int numThreads);
+
+#endif
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <omp.h>
+#include "matrix.h"
+
+Matrix createMatrix(int rows, int cols) {
+  Matrix M = NULL;
+  size_t bytes = (size_t)rows * cols * sizeof(M[0]);
+  //big matrices start on a huge page boundary so THP can back them from the first byte
+  size_t align = (bytes >= MATRIX_HUGE_THRESHOLD) ? MATRIX_HUGE_ALIGN : MATRIX_ALIGN;
+
+  //posix_memalign memory is released with free, so freeMatrix is unchanged. nothing is touched here: pages are
+  //placed by whichever thread writes them first
+  if (posix_memalign((void**)&M, align, bytes > 0 ? bytes : sizeof(M[0])) != 0) M = NULL;
+  if (M == 0) {
+    fprintf(stderr, "Matrix allocation failed in file %s, line %d\n", __FILE__,
+            __LINE__);
+    return NULL;
+  }
+
+#ifdef MADV_HUGEPAGE
+  //THP in madvise mode only covers regions that ask for it; MATRIX_THP=0 turns the request off for comparison
+  const char* thp = getenv("MATRIX_THP");
+  if (align == MATRIX_HUGE_ALIGN && !(thp && strcmp(thp, "0") == 0))
+    madvise(M, (bytes + MATRIX_HUGE_ALIGN - 1) & ~(size_t)(MATRIX_HUGE_ALIGN - 1), MADV_HUGEPAGE);
+#endif
+
+  return M;
+}
+
+void freeMatrix(Matrix M) {
+  if (M) free(M);
+  //set to null to make dangling ptr more safe
+  M = NULL;
+}
+
+void initMatrix(Matrix A, int rows, int cols) {
+  int i, j;
+
+  for (i = 0; i < rows; i++)
+    for (j = 0; j < cols; j++) A[(size_t)i * cols + j] = 1.0 / (i + j + 2);
+}
+
+void initMatrixParallel(Matrix A, int rows, int cols, int numThreads) {
+  int i = 0, j = 0;
+  //schedule(static) over rows: the same split WeakOpenMP uses, so each thread first touches the rows it later reads
+#pragma omp parallel for num_threads(numThreads) schedule(static) private(j)
+  for (i = 0; i < rows; i++)
+    for (j = 0; j < cols; j++) A[(size_t)i * cols + j] = 1.0 / (i + j + 2);
+}
+
+void initMatrixGenerator(float* gen, int rows, int cols) {
+  for (size_t s = 0; s < (size_t)rows + cols - 1; s++) gen[s] = 1.0 / (s + 2);
+}
+
+//sparse test problem stored dense: the 5 point stencil band of a grid with rows of about sqrt(cols), plus every
+//64th row holding an entry every 64 columns so row lengths are uneven. values follow initMatrix
+void initSparseMatrix(Matrix A, int rows, int cols){
+  int stride = 1;
+  while((stride + 1) * (stride + 1) <= cols) stride++;
+  int offsets[5] = {-stride, -1, 0, 1, stride};
+  memset(A, 0, (size_t)rows * cols * sizeof(A[0]));
+  for(int i = 0; i < rows; i++){
+    for(int o = 0; o < 5; o++){
+      int k = i + offsets[o];
+      if(k >= 0 && k < cols) A[(size_t)i * cols + k] = 1.0 / (i + k + 2);
+    }
+    if(i % 64 == 0){
+      for(int k = 0; k < cols; k += 64) A[(size_t)i * cols + k] = 1.0 / (i + k + 2);
+    }
+  }
+}
@@ -0,0 +1,25 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+//dense row-major matrix of floats shared by the experiments and kernels
+typedef float* Matrix;
+
+//every matrix starts on a cache line; ones of MATRIX_HUGE_THRESHOLD bytes or more start on a 2MB boundary and ask
+//for transparent huge pages unless MATRIX_THP=0
+#define MATRIX_ALIGN 64
+#define MATRIX_HUGE_ALIGN ((size_t)2 << 20)
+#define MATRIX_HUGE_THRESHOLD ((size_t)4 << 20)
+
+Matrix createMatrix(int rows, int cols);
+void freeMatrix(Matrix M);
+void initMatrix(Matrix A, int rows, int cols);
+//initMatrix split over threads by rows so every page is first touched, and so placed, on the NUMA node of the
+//thread that reads it under schedule(static)
+void initMatrixParallel(Matrix A, int rows, int cols, int numThreads);
+//initMatrix's entries depend only on i + j, so the same matrix is the Hankel generator gen[s] = 1/(s+2),
+//s < rows + cols - 1
+void initMatrixGenerator(float* gen, int rows, int cols);
+//the SpMV test problem, stored dense
+void initSparseMatrix(Matrix A, int rows, int cols);
+
+#endif
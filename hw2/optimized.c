@@ -6,33 +6,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <omp.h>
-
-typedef float* Matrix;
-
-Matrix createMatrix(int rows, int cols) {
-  Matrix M;
-
-  M = (Matrix)malloc(rows * cols * sizeof(M[0]));
-  if (M == 0)
-    fprintf(stderr, "Matrix allocation failed in file %s, line %d\n", __FILE__,
-            __LINE__);
-
-  return M;
-}
-
-void freeMatrix(Matrix M) {
-  if (M) free(M);
-  //set to null to make dangling ptr more safe
-  M = NULL;
-}
-
-void initMatrix(Matrix A, int rows, int cols) {
-  int i, j;
-
-  for (i = 0; i < rows; i++)
-    for (j = 0; j < cols; j++) A[i * cols + j] = 1.0 / (i + j + 2);
-}
+#include "matrix.h"
+#include "baseline.h"
+#include "gemv.h"
+#include "gemm.h"
+#include "gemvt.h"
+#include "sparse.h"
+#include "packed.h"
+#include "structured.h"
+#include "gemv2d.h"
+#include "matfile.h"
 
 //helper function for freeing components after experiments
 void closeExperiment(Matrix A, Matrix B, Matrix C){
@@ -41,65 +26,193 @@ void closeExperiment(Matrix A, Matrix B, Matrix C){
   freeMatrix(C);
 }
 
-//The unimproved control
-void matVecMult(Matrix A, Matrix B, Matrix C, int rows, int cols) {
-  int i, k;
+//time WeakOpenMP on the dense copy (when there is one) against CSR and SELL SpMV on the same matrix and append
+//the rows to results.csv under the given label suffix
+void sparseExperiment(Matrix dense, CsrMatrix* csr, SellMatrix* sell, Matrix x, Matrix y, int problemSize,
+                      int threads, const char* label){
+  double time1, time2, t_dense = 0, t_csr = 0, t_sell = 0;
+  double errorcheck_dense = 0, errorcheck_csr = 0, errorcheck_sell = 0;
+  int n = csr->rows, m = csr->cols;
+  for(int k = 0; k < 10; k++){
+    if(dense != NULL){
+      time1 = microtime();
+      WeakOpenMP(dense,x,y,n,m,threads);
+      time2 = microtime();
+      t_dense = t_dense + (time2 - time1);
+      errorcheck_dense = (double) y[n/2];
+    }
+    time1 = microtime();
+    spmvCsr(csr,x,y,threads);
+    time2 = microtime();
+    t_csr = t_csr + (time2 - time1);
+    errorcheck_csr = (double) y[n/2];
+    time1 = microtime();
+    spmvSell(sell,x,y,threads);
+    time2 = microtime();
+    t_sell = t_sell + (time2 - time1);
+    errorcheck_sell = (double) y[n/2];
+  }
 
-  for (k = 0; k < cols; k++)
-    for (i = 0; i < rows; i++)
-      C[i] += A[i * cols + k] * B[k];
+  FILE* file = fopen("results.csv", "a");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open file %s for appending\n", "results.csv");
+    exit(EXIT_FAILURE);
+  }
+  if(dense != NULL) fprintf(file,"WeakOpenMP%s,%d,%d,%g,%g\n",label,problemSize,threads,t_dense/10,errorcheck_dense);
+  fprintf(file,"SpmvCsr%s,%d,%d,%g,%g\n",label,problemSize,threads,t_csr/10,errorcheck_csr);
+  fprintf(file,"SpmvSell%s,%d,%d,%g,%g\n",label,problemSize,threads,t_sell/10,errorcheck_sell);
+  fclose(file);
 }
 
-//Experiment from HW1: Locality. We need to call our matrix in row major order or else we'll miss the cache
-//Result: major speedup
-void rowMajor(Matrix A, Matrix B, Matrix C, int rows, int cols){
+//time GEMV with each reduced precision copy of A. results.csv gets the usual row; precision.csv gets the error
+//against the fp32 run: the errorcheck entry and the largest error over all of C, both relative to max |C_fp32|
+void packedExperiment(PackedMatrix** packed, Matrix B, Matrix C, Matrix Cfp32, int n, int problemSize, int threads){
+  double maxRef = 0;
+  for(int r = 0; r < n; r++){
+    if(fabs(Cfp32[r]) > maxRef) maxRef = fabs(Cfp32[r]);
+  }
+  for(int s = 0; s < 3; s++){
+    if(packed[s] == NULL) continue;
+    double time1, time2, t_packed = 0, errorcheck_packed = 0;
+    for(int k = 0; k < 10; k++){
+      time1 = microtime();
+      gemvPacked(packed[s],B,C,threads);
+      time2 = microtime();
+      t_packed = t_packed + (time2 - time1);
+      errorcheck_packed = (double) C[n/2];
+    }
+    double maxErr = 0;
+    for(int r = 0; r < n; r++){
+      if(fabs((double)C[r] - Cfp32[r]) > maxErr) maxErr = fabs((double)C[r] - Cfp32[r]);
+    }
 
-  for(int i = 0; i < rows; i++){
-    for(int k = 0; k < cols; k++){
-      C[i] += A[i*cols + k] * B[k];
+    FILE* file = fopen("results.csv", "a");
+    if (file == NULL) {
+      fprintf(stderr, "Could not open file %s for appending\n", "results.csv");
+      exit(EXIT_FAILURE);
+    }
+    fprintf(file,"GemvPacked-%s,%d,%d,%g,%g\n",storageName(packed[s]->type),problemSize,threads,t_packed/10,errorcheck_packed);
+    fclose(file);
+    file = fopen("precision.csv", "a");
+    if (file == NULL) {
+      fprintf(stderr, "Could not open file %s for appending\n", "precision.csv");
+      exit(EXIT_FAILURE);
     }
+    fprintf(file,"GemvPacked-%s,%d,%d,%g,%g,%g,%g\n",storageName(packed[s]->type),problemSize,threads,errorcheck_packed,
+            (double)Cfp32[n/2],fabs(errorcheck_packed - Cfp32[n/2]) / maxRef,maxErr / maxRef);
+    fclose(file);
   }
 }
 
-//Experiment HW2: Weak Optimized. I theorize that using OpenMP on the row level will constitute a weak speedup
-//Results: 
-void WeakOpenMP(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads){
-  //initialize iterators outside threading for proper scope
-  int i = 0, k = 0;
-#pragma omp parallel for num_threads(numThreads) default(none) private(i,k) shared(A,B,C,rows,cols)
-  for(i = 0; i < rows; i++){
-    double localC = 0;
-    for(k = 0; k < cols; k++){
-      localC += A[i*cols + k] * B[k];
+//time the structured operator in both modes and append the rows; skipDirect leaves out the O(n^2) mode for sizes
+//where only the FFT is practical
+void structuredExperiment(StructuredMatrix* S, Matrix x, Matrix y, int problemSize, int threads, const char* label,
+                          int skipDirect){
+  StructuredMode modes[2] = {STRUCT_DIRECT, STRUCT_FFT};
+  const char* names[2] = {"Direct", "FFT"};
+  //the first FFT call also transforms the generator; keep that out of the timing
+  structuredGemv(S,x,y,STRUCT_FFT,threads);
+  for(int md = skipDirect ? 1 : 0; md < 2; md++){
+    double time1, time2, t_struct = 0, errorcheck_struct = 0;
+    for(int k = 0; k < 10; k++){
+      time1 = microtime();
+      structuredGemv(S,x,y,modes[md],threads);
+      time2 = microtime();
+      t_struct = t_struct + (time2 - time1);
+      errorcheck_struct = (double) y[S->rows/2];
     }
-
-    C[i] = localC;
+    FILE* file = fopen("results.csv", "a");
+    if (file == NULL) {
+      fprintf(stderr, "Could not open file %s for appending\n", "results.csv");
+      exit(EXIT_FAILURE);
+    }
+    fprintf(file,"Structured%s%s,%d,%d,%g,%g\n",names[md],label,problemSize,threads,t_struct/10,errorcheck_struct);
+    fclose(file);
   }
 }
 
-//Experiment HW2: Strong Optimized. I theorize that using OpenMP on the column level will constitute a strong speedup
-//There are more opporuntities to take advantage of parallel ops the more often the threads are applied
-//Results:
-void StrongOpenMP(Matrix A, Matrix B, Matrix C, int rows, int cols, int numThreads){
-  int i = 0, k = 0;
-
-  for(i = 0; i < rows; i++){
-    double rowTemp = 0;
-#pragma omp parallel for num_threads(numThreads) default(none) private(k) shared(A,B,i,rows,cols) reduction(+:rowTemp)
-    for(k = 0; k < cols; k++){
-      rowTemp += A[i*cols + k] * B[k];
+//the n*m entries of A viewed as a short and wide (16 rows) and a tall and narrow (16 columns) matrix, where row
+//only or column only splitting falls short. WeakOpenMP against gemv2D on each
+void shapeExperiment(Matrix A, int n, int m, int problemSize, int threads){
+  size_t total = (size_t)n * m;
+  int shapes[2][2] = {{16, (int)(total / 16)}, {(int)(total / 16), 16}};
+  const char* names[2] = {"wide", "tall"};
+  for(int s = 0; s < 2; s++){
+    int rows = shapes[s][0], cols = shapes[s][1];
+    if(rows < 1 || cols < 1) continue;
+    Matrix x = createMatrix(cols,1);
+    Matrix y = createMatrix(rows,1);
+    initMatrix(x,cols,1);
+    double time1, time2, t_weak = 0, t_2d = 0, errorcheck_weak = 0, errorcheck_2d = 0;
+    for(int k = 0; k < 10; k++){
+      time1 = microtime();
+      WeakOpenMP(A,x,y,rows,cols,threads);
+      time2 = microtime();
+      t_weak = t_weak + (time2 - time1);
+      errorcheck_weak = (double) y[rows/2];
+      time1 = microtime();
+      gemv2D(A,x,y,rows,cols,threads);
+      time2 = microtime();
+      t_2d = t_2d + (time2 - time1);
+      errorcheck_2d = (double) y[rows/2];
+    }
+    FILE* file = fopen("results.csv", "a");
+    if (file == NULL) {
+      fprintf(stderr, "Could not open file %s for appending\n", "results.csv");
+      exit(EXIT_FAILURE);
     }
+    fprintf(file,"WeakOpenMP-%s,%d,%d,%g,%g\n",names[s],problemSize,threads,t_weak/10,errorcheck_weak);
+    fprintf(file,"Gemv2D-%s,%d,%d,%g,%g\n",names[s],problemSize,threads,t_2d/10,errorcheck_2d);
+    fclose(file);
+    freeMatrix(x);
+    freeMatrix(y);
+  }
+}
+
+//row i of the values initMatrix generates, so A can be written to a file without ever being held in memory
+void fillRowInit(float* row, int i, int cols, void* arg){
+  (void)arg;
+  for(int j = 0; j < cols; j++) row[j] = 1.0 / (i + j + 2);
+}
 
-    //After threads rejoin due to reduction, can safely assign to C[i]
-    C[i] = rowTemp;
+//GEMV streamed from a mapped matrix file: warm with the file in the page cache, and cold with it dropped before
+//every repetition so each pass reads from disk
+void mappedExperiment(MatrixFile* F, Matrix x, Matrix y, int problemSize, int threads, const char* label){
+  int rows = (int)F->header.rows;
+  double time1, time2, t_warm = 0, t_cold = 0, errorcheck_warm = 0, errorcheck_cold = 0;
+  gemvMapped(F,x,y,0,threads);
+  for(int k = 0; k < 10; k++){
+    time1 = microtime();
+    gemvMapped(F,x,y,0,threads);
+    time2 = microtime();
+    t_warm = t_warm + (time2 - time1);
+    errorcheck_warm = (double) y[rows/2];
   }
+  for(int k = 0; k < 10; k++){
+    matrixFileEvict(F);
+    time1 = microtime();
+    gemvMapped(F,x,y,0,threads);
+    time2 = microtime();
+    t_cold = t_cold + (time2 - time1);
+    errorcheck_cold = (double) y[rows/2];
+  }
+  FILE* file = fopen("results.csv", "a");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open file %s for appending\n", "results.csv");
+    exit(EXIT_FAILURE);
+  }
+  fprintf(file,"GemvMapped%s,%d,%d,%g,%g\n",label,problemSize,threads,t_warm/10,errorcheck_warm);
+  fprintf(file,"GemvMapped-cold%s,%d,%d,%g,%g\n",label,problemSize,threads,t_cold/10,errorcheck_cold);
+  fclose(file);
 }
 
 //take 3 arguments for three different experiment sizes of matrices
 int main(int argc, char** argv) {
   
-  if (argc != 4){
-    fprintf(stderr,"Usage: %s exp1size exp2size exp3size", argv[0]);
+  //an optional 4th argument is a Matrix Market file (.mtx) for the sparse kernels or a binary matrix file (matfile.h)
+  //for the mapped GEMV
+  if (argc != 4 && argc != 5){
+    fprintf(stderr,"Usage: %s exp1size exp2size exp3size [matrix.mtx | matrix.bin]", argv[0]);
   }	  
     	
   int problemSizes[3];
@@ -121,6 +234,13 @@ int main(int argc, char** argv) {
   }
   fprintf(file,"Experiment,ProblemSize,NumberThreads,Time (us),ErrorCheck\n");
   fclose(file);
+  file = fopen("precision.csv", "w");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open file %s for writing\n", "precision.csv");
+    exit(EXIT_FAILURE);
+  }
+  fprintf(file,"Experiment,ProblemSize,NumberThreads,ErrorCheck,Fp32ErrorCheck,RelError,MaxRelError\n");
+  fclose(file);
   
   //Loop through job sizes
   for(int i = 0; i < 3; i++){
@@ -137,16 +257,37 @@ int main(int argc, char** argv) {
     B = createMatrix(m,p);
     C = createMatrix(n,p);
     
-    initMatrix(A,n,m);
+    //first touch with the most threads tried, split the way the row parallel kernels split A
+    initMatrixParallel(A,n,m,numThreads[3]);
     initMatrix(B,m,p);
     memset(C, 0, n * p * sizeof(C[0]));
 
+    //sparse version of the same size problem, kept dense as well so WeakOpenMP runs on identical data
+    Matrix As = createMatrix(n,m);
+    initSparseMatrix(As,n,m);
+    CsrMatrix* csr = csrFromDense(As,n,m);
+    SellMatrix* sell = (csr != NULL) ? sellFromCsr(csr,SELL_SIGMA) : NULL;
+
+    //reduced precision copies of A, and the fp32 result they are judged against
+    PackedMatrix* packed[3] = {packMatrix(A,n,m,STORE_BF16), packMatrix(A,n,m,STORE_FP16), packMatrix(A,n,m,STORE_INT8)};
+    Matrix Cfp32 = createMatrix(n,p);
+    gemvSimd(A,B,Cfp32,n,m,1);
+
+    //A is Hankel; recognizing it replaces the n*m entries with n+m-1 generator values
+    StructuredMatrix* hankel = structuredFromDense(A,n,m);
+
+    //the same A written out as a matrix file and mapped back
+    MatrixFile* mapped = NULL;
+    if(matrixFileWrite("matrix.bin",n,m,256,fillRowInit,NULL) == 0){
+      mapped = matrixFileOpen("matrix.bin");
+    }
+
     //loop through number threads
     for(int j = 0; j < 4; j++){
       //exectution time for each experiment. time1 and time2 are start and end times for each test
-      double t=0, time1=0, time2=0, t_exp1=0, t_exp2=0, t_exp3=0;
+      double t=0, time1=0, time2=0, t_exp1=0, t_exp2=0, t_exp3=0, t_exp4=0, t_exp5=0, t_exp6=0;
       //check C[n/2] to make sure optimizations haven't affected what number we calculate
-      double errorcheck_control=0, errorcheck_rowmajor=0, errorcheck_weakmp=0, errorcheck_strongmp=0;
+      double errorcheck_control=0, errorcheck_rowmajor=0, errorcheck_weakmp=0, errorcheck_strongmp=0, errorcheck_simd=0, errorcheck_transpose=0, errorcheck_2d=0;
       //run experiments ten times and take average
       for(int k = 0; k < 10; k++){
         //control run 
@@ -165,23 +306,47 @@ int main(int argc, char** argv) {
         memset(C,0,n*sizeof(C[0]));
 	//parallelize row ops
         time1 = microtime();
-        WeakOpenMP(A,B,C,n,m,j);
+        WeakOpenMP(A,B,C,n,m,numThreads[j]);
         time2 = microtime();
         t_exp2 = t_exp2 + (time2 - time1);
 	errorcheck_weakmp = (double) C[n/2];
         memset(C,0,n*sizeof(C[0]));
 	//parallelize column ops
         time1 = microtime();
-        StrongOpenMP(A,B,C,n,m,j);
+        StrongOpenMP(A,B,C,n,m,numThreads[j]);
         time2 = microtime();
         t_exp3 = t_exp3 + (time2 - time1);
 	errorcheck_strongmp = (double) C[n/2];
 	memset(C,0,n*sizeof(C[0]));
+	//register blocked SIMD kernel, parallel over row blocks
+        time1 = microtime();
+        gemvSimd(A,B,C,n,m,numThreads[j]);
+        time2 = microtime();
+        t_exp4 = t_exp4 + (time2 - time1);
+	errorcheck_simd = (double) C[n/2];
+	memset(C,0,n*sizeof(C[0]));
+	//y = A^T x, still reading A in row order. A is symmetric here so the check matches the others
+        time1 = microtime();
+        gemvTranspose(A,B,C,n,m,numThreads[j]);
+        time2 = microtime();
+        t_exp5 = t_exp5 + (time2 - time1);
+	errorcheck_transpose = (double) C[m/2];
+	memset(C,0,n*sizeof(C[0]));
+	//2D grid of blocks in one parallel region
+        time1 = microtime();
+        gemv2D(A,B,C,n,m,numThreads[j]);
+        time2 = microtime();
+        t_exp6 = t_exp6 + (time2 - time1);
+	errorcheck_2d = (double) C[n/2];
+	memset(C,0,n*sizeof(C[0]));
       }
       t = t/10;
       t_exp1 = t_exp1/10;
       t_exp2 = t_exp2/10;
       t_exp3 = t_exp3/10;
+      t_exp4 = t_exp4/10;
+      t_exp5 = t_exp5/10;
+      t_exp6 = t_exp6/10;
 
       // Print results for this problem size and thread number
       FILE* file = fopen("results.csv", "a");
@@ -193,11 +358,124 @@ int main(int argc, char** argv) {
       fprintf(file,"RowMajor,%d,%d,%g,%g\n",problemSizes[i],numThreads[j],t_exp1,errorcheck_rowmajor);
       fprintf(file,"WeakOpenMP,%d,%d,%g,%g\n",problemSizes[i],numThreads[j],t_exp2,errorcheck_weakmp);
       fprintf(file,"StrongOpenMP,%d,%d,%g,%g\n",problemSizes[i],numThreads[j],t_exp3,errorcheck_strongmp);
+      fprintf(file,"GemvSIMD-%s,%d,%d,%g,%g\n",gemvIsaName(),problemSizes[i],numThreads[j],t_exp4,errorcheck_simd);
+      fprintf(file,"GemvTranspose,%d,%d,%g,%g\n",problemSizes[i],numThreads[j],t_exp5,errorcheck_transpose);
+      fprintf(file,"Gemv2D,%d,%d,%g,%g\n",problemSizes[i],numThreads[j],t_exp6,errorcheck_2d);
       fclose(file);
+
+      //batched right hand sides: the same A against p vectors at once, B is m x p
+      int batchSizes[3] = {4, 16, 64};
+      for(int b = 0; b < 3; b++){
+        int batch = batchSizes[b];
+        Matrix Bp = createMatrix(m,batch);
+        Matrix Cp = createMatrix(n,batch);
+        initMatrix(Bp,m,batch);
+        double t_batch = 0, errorcheck_batch = 0;
+        for(int k = 0; k < 10; k++){
+          time1 = microtime();
+          gemmLite(A,Bp,Cp,n,m,batch,numThreads[j]);
+          time2 = microtime();
+          t_batch = t_batch + (time2 - time1);
+          //column 0 of B is the same vector as the p = 1 runs
+          errorcheck_batch = (double) Cp[(size_t)(n/2)*batch];
+        }
+        t_batch = t_batch/10;
+        file = fopen("results.csv", "a");
+        if (file == NULL) {
+          fprintf(stderr, "Could not open file %s for appending\n", "results.csv");
+          exit(EXIT_FAILURE);
+        }
+        fprintf(file,"GemmLite-p%d,%d,%d,%g,%g\n",batch,problemSizes[i],numThreads[j],t_batch,errorcheck_batch);
+        fclose(file);
+        freeMatrix(Bp);
+        freeMatrix(Cp);
+      }
+
+      if(sell != NULL){
+        sparseExperiment(As,csr,sell,B,C,problemSizes[i],numThreads[j],"-sparse");
+      }
+      packedExperiment(packed,B,C,Cfp32,n,problemSizes[i],numThreads[j]);
+      shapeExperiment(A,n,m,problemSizes[i],numThreads[j]);
+      if(hankel != NULL){
+        structuredExperiment(hankel,B,C,problemSizes[i],numThreads[j],"",0);
+      }
+      if(mapped != NULL){
+        mappedExperiment(mapped,B,C,problemSizes[i],numThreads[j],"");
+      }
    }
 
+   matrixFileClose(mapped);
+   remove("matrix.bin");
+
+   freeStructured(hankel);
+
+   for(int s = 0; s < 3; s++){
+     freePacked(packed[s]);
+   }
+   freeMatrix(Cfp32);
+
+   freeMatrix(As);
+   freeSell(sell);
+   freeCsr(csr);
    closeExperiment(A,B,C);
   }
 
+  //the same generated matrix at a size that could never be stored dense (4 TB): FFT only, straight from the
+  //generator
+  int largeSize = 1000000;
+  float* gen = (float*)malloc((size_t)2 * largeSize * sizeof(float));
+  Matrix xLarge = createMatrix(largeSize,1);
+  Matrix yLarge = createMatrix(largeSize,1);
+  if(gen != NULL && xLarge != NULL && yLarge != NULL){
+    initMatrixGenerator(gen,largeSize,largeSize);
+    initMatrix(xLarge,largeSize,1);
+    StructuredMatrix* hankel = structuredFromGenerator(STRUCT_HANKEL,gen,largeSize,largeSize);
+    if(hankel != NULL){
+      for(int j = 0; j < 4; j++){
+        structuredExperiment(hankel,xLarge,yLarge,largeSize,numThreads[j],"-large",1);
+      }
+    }
+    freeStructured(hankel);
+  }
+  free(gen);
+  freeMatrix(xLarge);
+  freeMatrix(yLarge);
+
+  size_t argLen = (argc == 5) ? strlen(argv[4]) : 0;
+  if(argc == 5 && argLen >= 4 && strcmp(argv[4] + argLen - 4, ".mtx") == 0){
+    CsrMatrix* csr = csrLoad(argv[4]);
+    SellMatrix* sell = (csr != NULL) ? sellFromCsr(csr,SELL_SIGMA) : NULL;
+    if(sell != NULL){
+      Matrix x = createMatrix(csr->cols,1);
+      Matrix y = createMatrix(csr->rows,1);
+      initMatrix(x,csr->cols,1);
+      //the dense comparison only when it fits comfortably in memory
+      Matrix dense = ((size_t)csr->rows * csr->cols <= ((size_t)1 << 27)) ? csrToDense(csr) : NULL;
+      for(int j = 0; j < 4; j++){
+        sparseExperiment(dense,csr,sell,x,y,csr->rows,numThreads[j],"-file");
+      }
+      freeMatrix(dense);
+      freeMatrix(x);
+      freeMatrix(y);
+    }
+    freeSell(sell);
+    freeCsr(csr);
+  }else if(argc == 5){
+    //may be larger than memory: only the mapped GEMV touches it
+    MatrixFile* F = matrixFileOpen(argv[4]);
+    if(F != NULL){
+      int rows = (int)F->header.rows, cols = (int)F->header.cols;
+      Matrix x = createMatrix(cols,1);
+      Matrix y = createMatrix(rows,1);
+      initMatrix(x,cols,1);
+      for(int j = 0; j < 4; j++){
+        mappedExperiment(F,x,y,rows,numThreads[j],"-file");
+      }
+      freeMatrix(x);
+      freeMatrix(y);
+    }
+    matrixFileClose(F);
+  }
+
   return 0;
 }
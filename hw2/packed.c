@@ -0,0 +1,303 @@
+//reduced precision GEMV. the kernels mirror gemv.c: four rows per pass share each load of B, two accumulators per
+//row, and the element type is a literal at every call site so each type gets its own loop with the widening inlined
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <immintrin.h>
+#include <omp.h>
+#include "packed.h"
+#include "gemv.h"
+
+//rows handed to a kernel call; parallel work is split on these blocks
+#define PACKED_ROW_BLOCK 64
+
+static const char* storageNames[] = {
+  [STORE_BF16] = "bf16",
+  [STORE_FP16] = "fp16",
+  [STORE_INT8] = "int8",
+};
+
+const char* storageName(StorageType type){
+  return storageNames[type];
+}
+
+//bf16 is the top half of an fp32; round to nearest even on the dropped half, NaNs stay NaN
+static uint16_t floatToBf16(float f){
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  if((x & 0x7fffffff) > 0x7f800000) return (uint16_t)((x >> 16) | 0x40);
+  x += 0x7fff + ((x >> 16) & 1);
+  return (uint16_t)(x >> 16);
+}
+
+static float bf16ToFloat(uint16_t h){
+  uint32_t x = (uint32_t)h << 16;
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+//IEEE half, round to nearest even, with subnormals; done in software so packing does not need F16C
+static uint16_t floatToHalf(float f){
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  uint32_t sign = (x >> 16) & 0x8000;
+  int exp = (int)((x >> 23) & 0xff) - 127 + 15;
+  uint32_t mant = x & 0x7fffff;
+  if(((x >> 23) & 0xff) == 0xff) return (uint16_t)(sign | 0x7c00 | (mant ? 0x200 : 0));
+  if(exp >= 31) return (uint16_t)(sign | 0x7c00);
+  if(exp <= 0){
+    if(exp < -10) return (uint16_t)sign;
+    mant |= 0x800000;
+    int shift = 14 - exp;
+    uint32_t h = mant >> shift;
+    uint32_t rem = mant & ((1u << shift) - 1), half = 1u << (shift - 1);
+    if(rem > half || (rem == half && (h & 1))) h++;
+    return (uint16_t)(sign | h);
+  }
+  //a carry out of the mantissa bumps the exponent, and out of the largest exponent gives infinity
+  uint32_t h = ((uint32_t)exp << 10) | (mant >> 13);
+  uint32_t rem = mant & 0x1fff;
+  if(rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+  return (uint16_t)(sign | h);
+}
+
+static float halfToFloat(uint16_t h){
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1f, mant = h & 0x3ff;
+  uint32_t x;
+  if(exp == 0){
+    float f = (float)mant * (1.0f / 16777216.0f);
+    return sign ? -f : f;
+  }
+  if(exp == 31) x = sign | 0x7f800000 | (mant << 13);
+  else x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+PackedMatrix* packMatrix(Matrix A, int rows, int cols, StorageType type){
+  size_t elemSize = (type == STORE_INT8) ? 1 : 2;
+  PackedMatrix* P = (PackedMatrix*)calloc(1, sizeof(PackedMatrix));
+  if(P == NULL){
+    fprintf(stderr, "Packed matrix allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    return NULL;
+  }
+  P->type = type;
+  P->rows = rows;
+  P->cols = cols;
+  P->data = malloc((size_t)rows * cols * elemSize);
+  if(type == STORE_INT8) P->scale = (float*)malloc((size_t)rows * sizeof(float));
+  if(P->data == NULL || (type == STORE_INT8 && P->scale == NULL)){
+    fprintf(stderr, "Packed matrix allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    freePacked(P);
+    return NULL;
+  }
+
+  for(int i = 0; i < rows; i++){
+    const float* a = A + (size_t)i * cols;
+    if(type == STORE_INT8){
+      int8_t* q = (int8_t*)P->data + (size_t)i * cols;
+      float maxAbs = 0;
+      for(int k = 0; k < cols; k++){
+        if(fabsf(a[k]) > maxAbs) maxAbs = fabsf(a[k]);
+      }
+      //an all zero row keeps scale 1 so the inverse below stays finite
+      float scale = (maxAbs > 0) ? maxAbs / 127.0f : 1.0f;
+      P->scale[i] = scale;
+      for(int k = 0; k < cols; k++){
+        long v = lrintf(a[k] / scale);
+        q[k] = (int8_t)(v > 127 ? 127 : (v < -127 ? -127 : v));
+      }
+    }else{
+      uint16_t* h = (uint16_t*)P->data + (size_t)i * cols;
+      for(int k = 0; k < cols; k++){
+        h[k] = (type == STORE_BF16) ? floatToBf16(a[k]) : floatToHalf(a[k]);
+      }
+    }
+  }
+  return P;
+}
+
+void freePacked(PackedMatrix* P){
+  if(P == NULL) return;
+  free(P->data);
+  free(P->scale);
+  free(P);
+}
+
+//element k of row i widened to fp32, without the int8 row scale
+static inline float packedElement(const PackedMatrix* P, size_t at){
+  switch(P->type){
+    case STORE_BF16: return bf16ToFloat(((const uint16_t*)P->data)[at]);
+    case STORE_FP16: return halfToFloat(((const uint16_t*)P->data)[at]);
+    default:         return ((const int8_t*)P->data)[at];
+  }
+}
+
+//plain C fallback, also used for the leftover rows and columns of the SIMD kernels. k starts at k0 so a SIMD
+//kernel can hand over just its column tail; the int8 scale is applied by the caller
+static float packedDotScalar(const PackedMatrix* P, const float* B, int i, int k0){
+  size_t row = (size_t)i * P->cols;
+  float s = 0;
+  for(int k = k0; k < P->cols; k++){
+    s += packedElement(P, row + k) * B[k];
+  }
+  return s;
+}
+
+static void packedRowsScalar(const PackedMatrix* P, const float* B, float* C, int row0, int row1){
+  for(int i = row0; i < row1; i++){
+    float s = packedDotScalar(P, B, i, 0);
+    C[i] = (P->type == STORE_INT8) ? s * P->scale[i] : s;
+  }
+}
+
+//16 elements at p widened to fp32
+__attribute__((target("avx512f"), always_inline))
+static inline __m512 widen512(const void* p, const StorageType type){
+  switch(type){
+    case STORE_BF16:
+      return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)p)), 16));
+    case STORE_FP16:
+      return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)p));
+    default:
+      return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)p)));
+  }
+}
+
+__attribute__((target("avx512f"), always_inline))
+static inline void packedRowsAvx512Typed(const PackedMatrix* P, const float* B, float* C, int row0, int row1,
+                                         const StorageType type){
+  int cols = P->cols;
+  size_t elemSize = (type == STORE_INT8) ? 1 : 2;
+  const char* data = (const char*)P->data;
+  int i = row0;
+  for(; i + 4 <= row1; i += 4){
+    const char* a0 = data + (size_t)i * cols * elemSize;
+    const char* a1 = a0 + (size_t)cols * elemSize;
+    const char* a2 = a1 + (size_t)cols * elemSize;
+    const char* a3 = a2 + (size_t)cols * elemSize;
+    __m512 s00 = _mm512_setzero_ps(), s01 = _mm512_setzero_ps();
+    __m512 s10 = _mm512_setzero_ps(), s11 = _mm512_setzero_ps();
+    __m512 s20 = _mm512_setzero_ps(), s21 = _mm512_setzero_ps();
+    __m512 s30 = _mm512_setzero_ps(), s31 = _mm512_setzero_ps();
+    int k = 0;
+    for(; k + 32 <= cols; k += 32){
+      __m512 b0 = _mm512_loadu_ps(B + k), b1 = _mm512_loadu_ps(B + k + 16);
+      size_t off0 = (size_t)k * elemSize, off1 = (size_t)(k + 16) * elemSize;
+      s00 = _mm512_fmadd_ps(widen512(a0 + off0, type), b0, s00);
+      s01 = _mm512_fmadd_ps(widen512(a0 + off1, type), b1, s01);
+      s10 = _mm512_fmadd_ps(widen512(a1 + off0, type), b0, s10);
+      s11 = _mm512_fmadd_ps(widen512(a1 + off1, type), b1, s11);
+      s20 = _mm512_fmadd_ps(widen512(a2 + off0, type), b0, s20);
+      s21 = _mm512_fmadd_ps(widen512(a2 + off1, type), b1, s21);
+      s30 = _mm512_fmadd_ps(widen512(a3 + off0, type), b0, s30);
+      s31 = _mm512_fmadd_ps(widen512(a3 + off1, type), b1, s31);
+    }
+    float c[4] = {_mm512_reduce_add_ps(_mm512_add_ps(s00, s01)), _mm512_reduce_add_ps(_mm512_add_ps(s10, s11)),
+                  _mm512_reduce_add_ps(_mm512_add_ps(s20, s21)), _mm512_reduce_add_ps(_mm512_add_ps(s30, s31))};
+    for(int r = 0; r < 4; r++){
+      c[r] += packedDotScalar(P, B, i + r, k);
+      C[i + r] = (type == STORE_INT8) ? c[r] * P->scale[i + r] : c[r];
+    }
+  }
+  packedRowsScalar(P, B, C, i, row1);
+}
+
+__attribute__((target("avx512f")))
+static void packedRowsAvx512(const PackedMatrix* P, const float* B, float* C, int row0, int row1){
+  switch(P->type){
+    case STORE_BF16: packedRowsAvx512Typed(P, B, C, row0, row1, STORE_BF16); break;
+    case STORE_FP16: packedRowsAvx512Typed(P, B, C, row0, row1, STORE_FP16); break;
+    default:         packedRowsAvx512Typed(P, B, C, row0, row1, STORE_INT8); break;
+  }
+}
+
+//8 elements at p widened to fp32; fp16 needs F16C, which every AVX2 cpu we target has
+__attribute__((target("avx2,fma,f16c"), always_inline))
+static inline __m256 widen256(const void* p, const StorageType type){
+  switch(type){
+    case STORE_BF16:
+      return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)), 16));
+    case STORE_FP16:
+      return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+    default:
+      return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)p)));
+  }
+}
+
+__attribute__((target("avx2,fma,f16c"), always_inline))
+static inline float hsum256Packed(__m256 v){
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma,f16c"), always_inline))
+static inline void packedRowsAvx2Typed(const PackedMatrix* P, const float* B, float* C, int row0, int row1,
+                                       const StorageType type){
+  int cols = P->cols;
+  size_t elemSize = (type == STORE_INT8) ? 1 : 2;
+  const char* data = (const char*)P->data;
+  int i = row0;
+  for(; i + 4 <= row1; i += 4){
+    const char* a0 = data + (size_t)i * cols * elemSize;
+    const char* a1 = a0 + (size_t)cols * elemSize;
+    const char* a2 = a1 + (size_t)cols * elemSize;
+    const char* a3 = a2 + (size_t)cols * elemSize;
+    __m256 s00 = _mm256_setzero_ps(), s01 = _mm256_setzero_ps();
+    __m256 s10 = _mm256_setzero_ps(), s11 = _mm256_setzero_ps();
+    __m256 s20 = _mm256_setzero_ps(), s21 = _mm256_setzero_ps();
+    __m256 s30 = _mm256_setzero_ps(), s31 = _mm256_setzero_ps();
+    int k = 0;
+    for(; k + 16 <= cols; k += 16){
+      __m256 b0 = _mm256_loadu_ps(B + k), b1 = _mm256_loadu_ps(B + k + 8);
+      size_t off0 = (size_t)k * elemSize, off1 = (size_t)(k + 8) * elemSize;
+      s00 = _mm256_fmadd_ps(widen256(a0 + off0, type), b0, s00);
+      s01 = _mm256_fmadd_ps(widen256(a0 + off1, type), b1, s01);
+      s10 = _mm256_fmadd_ps(widen256(a1 + off0, type), b0, s10);
+      s11 = _mm256_fmadd_ps(widen256(a1 + off1, type), b1, s11);
+      s20 = _mm256_fmadd_ps(widen256(a2 + off0, type), b0, s20);
+      s21 = _mm256_fmadd_ps(widen256(a2 + off1, type), b1, s21);
+      s30 = _mm256_fmadd_ps(widen256(a3 + off0, type), b0, s30);
+      s31 = _mm256_fmadd_ps(widen256(a3 + off1, type), b1, s31);
+    }
+    float c[4] = {hsum256Packed(_mm256_add_ps(s00, s01)), hsum256Packed(_mm256_add_ps(s10, s11)),
+                  hsum256Packed(_mm256_add_ps(s20, s21)), hsum256Packed(_mm256_add_ps(s30, s31))};
+    for(int r = 0; r < 4; r++){
+      c[r] += packedDotScalar(P, B, i + r, k);
+      C[i + r] = (type == STORE_INT8) ? c[r] * P->scale[i + r] : c[r];
+    }
+  }
+  packedRowsScalar(P, B, C, i, row1);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void packedRowsAvx2(const PackedMatrix* P, const float* B, float* C, int row0, int row1){
+  switch(P->type){
+    case STORE_BF16: packedRowsAvx2Typed(P, B, C, row0, row1, STORE_BF16); break;
+    case STORE_FP16: packedRowsAvx2Typed(P, B, C, row0, row1, STORE_FP16); break;
+    default:         packedRowsAvx2Typed(P, B, C, row0, row1, STORE_INT8); break;
+  }
+}
+
+void gemvPacked(const PackedMatrix* P, Matrix B, Matrix C, int numThreads){
+  void (*kernel)(const PackedMatrix*, const float*, float*, int, int);
+  switch(gemvSelectedIsa()){
+    case ISA_AVX512: kernel = packedRowsAvx512; break;
+    case ISA_AVX2:   kernel = __builtin_cpu_supports("f16c") ? packedRowsAvx2 : packedRowsScalar; break;
+    default:         kernel = packedRowsScalar; break;
+  }
+  int numBlocks = (P->rows + PACKED_ROW_BLOCK - 1) / PACKED_ROW_BLOCK;
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+  for(int b = 0; b < numBlocks; b++){
+    int row0 = b * PACKED_ROW_BLOCK;
+    int row1 = (row0 + PACKED_ROW_BLOCK < P->rows) ? row0 + PACKED_ROW_BLOCK : P->rows;
+    kernel(P, B, C, row0, row1);
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <stdint.h>
+#include "matrix.h"
+
+//reduced precision copies of A for GEMV. GEMV streams every element of A once, so halving or quartering the bytes
+//per element raises the ceiling by the same factor. elements are widened to fp32 in registers and all sums are
+//fp32. int8 stores each row as round(A[i, k] / scale[i]) with scale[i] = max |A[i, :]| / 127
+typedef enum { STORE_BF16, STORE_FP16, STORE_INT8 } StorageType;
+
+typedef struct {
+  StorageType type;
+  int rows, cols;
+  void* data;     //uint16_t for bf16 and fp16, int8_t for int8; rows x cols row major
+  float* scale;   //per row, int8 only
+} PackedMatrix;
+
+//returns NULL (after a message on stderr) if allocation fails
+PackedMatrix* packMatrix(Matrix A, int rows, int cols, StorageType type);
+void freePacked(PackedMatrix* P);
+const char* storageName(StorageType type);
+
+//C = A*B with the packed A, on the instruction set gemvSimd picked
+void gemvPacked(const PackedMatrix* P, Matrix B, Matrix C, int numThreads);
+
+#endif
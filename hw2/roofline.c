@@ -0,0 +1,374 @@
+//Roofline benchmark for the matrix vector variants
+//every variant runs on square problems sized to sit in L1, L2, L3 and DRAM. each point is reported as GB/s of
+//compulsory traffic (every byte of A, x and y moved once) and GFLOP/s, next to the ceilings measured on this
+//machine: STREAM triad bandwidth at the same level and peak FMA throughput. a kernel doing I flops per byte can
+//reach at most min(peak, I * bandwidth), and Roof % is how much of that it gets
+//writes roofline.csv and ceilings.csv; an optional argument sets the DRAM point's footprint in MB
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <omp.h>
+#include "matrix.h"
+#include "bench.h"
+#include "baseline.h"
+#include "gemv.h"
+#include "gemm.h"
+#include "gemvt.h"
+#include "gemv2d.h"
+#include "packed.h"
+#include "sparse.h"
+
+#define NUM_THREAD_COUNTS 4
+static const int threadCounts[NUM_THREAD_COUNTS] = {1, 2, 4, 8};
+
+typedef enum { LEVEL_L1, LEVEL_L2, LEVEL_L3, LEVEL_DRAM, NUM_LEVELS } Level;
+static const char* levelNames[NUM_LEVELS] = {"L1", "L2", "L3", "DRAM"};
+
+typedef enum {
+  V_UNOPTIMIZED, V_ROWMAJOR, V_WEAK, V_STRONG, V_SIMD, V_TRANSPOSE, V_2D,
+  V_GEMM4, V_GEMM16, V_GEMM64, V_BF16, V_FP16, V_INT8, V_CSR, V_SELL, NUM_VARIANTS
+} Variant;
+
+static const char* variantNames[NUM_VARIANTS] = {
+  [V_UNOPTIMIZED] = "Unoptimized",
+  [V_ROWMAJOR]    = "RowMajor",
+  [V_WEAK]        = "WeakOpenMP",
+  [V_STRONG]      = "StrongOpenMP",
+  [V_SIMD]        = "GemvSIMD",
+  [V_TRANSPOSE]   = "GemvTranspose",
+  [V_2D]          = "Gemv2D",
+  [V_GEMM4]       = "GemmLite-p4",
+  [V_GEMM16]      = "GemmLite-p16",
+  [V_GEMM64]      = "GemmLite-p64",
+  [V_BF16]        = "GemvPacked-bf16",
+  [V_FP16]        = "GemvPacked-fp16",
+  [V_INT8]        = "GemvPacked-int8",
+  [V_CSR]         = "SpmvCsr",
+  [V_SELL]        = "SpmvSell",
+};
+
+//the HW1 loops have no threads; they run once per point
+static int serialVariant(Variant v){
+  return v == V_UNOPTIMIZED || v == V_ROWMAJOR;
+}
+
+//right hand sides of the batched variants
+static int batchOf(Variant v){
+  return (v == V_GEMM4) ? 4 : (v == V_GEMM16) ? 16 : (v == V_GEMM64) ? 64 : 1;
+}
+
+//operands for one problem size. x and y hold max(rows, cols) entries so the transpose fits as well
+typedef struct {
+  int rows, cols;
+  Matrix A, x, y;
+  Matrix X, Y;            //cols x 64 and rows x 64 for the batched runs
+  PackedMatrix* packed;   //built for the packed variant being timed
+  CsrMatrix* csr;         //the SpMV test problem at this size
+  SellMatrix* sell;
+} Point;
+
+//one timed call: rows may be a leading block of A for the weak scaling runs
+typedef struct {
+  Variant variant;
+  Point* pt;
+  int rows;
+  int numThreads;
+} Call;
+
+static void runCall(void* arg){
+  Call* c = (Call*)arg;
+  Point* pt = c->pt;
+  int n = c->rows, m = pt->cols, t = c->numThreads;
+  switch(c->variant){
+    case V_UNOPTIMIZED: matVecMult(pt->A,pt->x,pt->y,n,m); break;
+    case V_ROWMAJOR:    rowMajor(pt->A,pt->x,pt->y,n,m); break;
+    case V_WEAK:        WeakOpenMP(pt->A,pt->x,pt->y,n,m,t); break;
+    case V_STRONG:      StrongOpenMP(pt->A,pt->x,pt->y,n,m,t); break;
+    case V_SIMD:        gemvSimd(pt->A,pt->x,pt->y,n,m,t); break;
+    case V_TRANSPOSE:   gemvTranspose(pt->A,pt->x,pt->y,n,m,t); break;
+    case V_2D:          gemv2D(pt->A,pt->x,pt->y,n,m,t); break;
+    case V_GEMM4:
+    case V_GEMM16:
+    case V_GEMM64:      gemmLite(pt->A,pt->X,pt->Y,n,m,batchOf(c->variant),t); break;
+    case V_BF16:
+    case V_FP16:
+    case V_INT8:        gemvPacked(pt->packed,pt->x,pt->y,t); break;
+    case V_CSR:         spmvCsr(pt->csr,pt->x,pt->y,t); break;
+    case V_SELL:        spmvSell(pt->sell,pt->x,pt->y,t); break;
+    default: break;
+  }
+}
+
+//the arrays a call reads or writes, each counted once: the compulsory traffic, and what gets flushed. sets the
+//useful flops (padding in SELL chunks does not count)
+static int callRegions(const Call* c, BenchRegion* r, double* flops){
+  const Point* pt = c->pt;
+  size_t n = c->rows, m = pt->cols, f = sizeof(float);
+  int count = 0;
+  switch(c->variant){
+    case V_GEMM4:
+    case V_GEMM16:
+    case V_GEMM64: {
+      size_t p = batchOf(c->variant);
+      r[count++] = (BenchRegion){pt->A, n * m * f};
+      r[count++] = (BenchRegion){pt->X, m * p * f};
+      r[count++] = (BenchRegion){pt->Y, n * p * f};
+      *flops = 2.0 * n * m * p;
+      return count;
+    }
+    case V_BF16:
+    case V_FP16:
+    case V_INT8: {
+      const PackedMatrix* P = pt->packed;
+      size_t elem = (P->type == STORE_INT8) ? 1 : 2;
+      r[count++] = (BenchRegion){P->data, n * m * elem};
+      if(P->scale != NULL) r[count++] = (BenchRegion){P->scale, n * f};
+      *flops = 2.0 * n * m;
+      break;
+    }
+    case V_CSR: {
+      const CsrMatrix* M = pt->csr;
+      r[count++] = (BenchRegion){M->rowPtr, (n + 1) * sizeof(long)};
+      r[count++] = (BenchRegion){M->colIdx, M->nnz * sizeof(int)};
+      r[count++] = (BenchRegion){M->val, M->nnz * f};
+      *flops = 2.0 * M->nnz;
+      break;
+    }
+    case V_SELL: {
+      const SellMatrix* S = pt->sell;
+      r[count++] = (BenchRegion){S->chunkPtr, (S->numChunks + 1) * sizeof(long)};
+      r[count++] = (BenchRegion){S->chunkLen, S->numChunks * sizeof(int)};
+      r[count++] = (BenchRegion){S->colIdx, S->stored * sizeof(int)};
+      r[count++] = (BenchRegion){S->val, S->stored * f};
+      r[count++] = (BenchRegion){S->perm, n * sizeof(int)};
+      *flops = 2.0 * S->nnz;
+      break;
+    }
+    default:
+      r[count++] = (BenchRegion){pt->A, n * m * f};
+      *flops = 2.0 * n * m;
+      break;
+  }
+  //the transpose reads rows entries of x and writes cols of y
+  size_t xLen = (c->variant == V_TRANSPOSE) ? n : m, yLen = (c->variant == V_TRANSPOSE) ? m : n;
+  r[count++] = (BenchRegion){pt->x, xLen * f};
+  r[count++] = (BenchRegion){pt->y, yLen * f};
+  return count;
+}
+
+static Level levelOf(size_t bytes, CacheSizes caches){
+  if(bytes <= caches.l1) return LEVEL_L1;
+  if(bytes <= caches.l2) return LEVEL_L2;
+  if(bytes <= caches.l3) return LEVEL_L3;
+  return LEVEL_DRAM;
+}
+
+//builds what the variant needs beyond A; returns -1 if it could not
+static int prepareVariant(Variant v, Point* pt){
+  int n = pt->rows, m = pt->cols;
+  if(v == V_BF16 || v == V_FP16 || v == V_INT8){
+    StorageType type = (v == V_BF16) ? STORE_BF16 : (v == V_FP16) ? STORE_FP16 : STORE_INT8;
+    pt->packed = packMatrix(pt->A,n,m,type);
+    return (pt->packed != NULL) ? 0 : -1;
+  }
+  if((v == V_CSR || v == V_SELL) && pt->csr == NULL){
+    Matrix As = createMatrix(n,m);
+    if(As == NULL) return -1;
+    initSparseMatrix(As,n,m);
+    pt->csr = csrFromDense(As,n,m);
+    freeMatrix(As);
+    pt->sell = (pt->csr != NULL) ? sellFromCsr(pt->csr,SELL_SIGMA) : NULL;
+  }
+  if(v == V_CSR) return (pt->csr != NULL) ? 0 : -1;
+  if(v == V_SELL) return (pt->sell != NULL) ? 0 : -1;
+  return 0;
+}
+
+static void releaseVariant(Variant v, Point* pt){
+  if(v == V_BF16 || v == V_FP16 || v == V_INT8){
+    freePacked(pt->packed);
+    pt->packed = NULL;
+  }
+  if(v == V_SELL){
+    freeSell(pt->sell);
+    freeCsr(pt->csr);
+    pt->sell = NULL;
+    pt->csr = NULL;
+  }
+}
+
+//machine ceilings, per level and thread count
+typedef struct {
+  CacheSizes caches;
+  size_t levelBytes[NUM_LEVELS];
+  double stream[NUM_LEVELS][NUM_THREAD_COUNTS];
+  double peak[NUM_THREAD_COUNTS];
+} Ceilings;
+
+//times one call and appends its row. flushed calls start from memory; the others run warm after the warmup.
+//t1 and weakT1 are the 1 thread medians the efficiencies are taken against: 0 marks the 1 thread row itself and
+//a negative value leaves the column empty
+static double measure(FILE* file, Call* call, const char* suffix, int flush, const Ceilings* lim, int threadIdx,
+                      double t1, double weakT1){
+  BenchRegion regions[8];
+  double flops = 0;
+  int numRegions = callRegions(call, regions, &flops);
+  size_t bytes = 0;
+  for(int r = 0; r < numRegions; r++) bytes += regions[r].bytes;
+  BenchStats s = benchTime(runCall, call, regions, flush ? numRegions : 0);
+
+  //a flushed call streams from memory whatever its size, so it is judged against the DRAM ceiling
+  Level level = flush ? LEVEL_DRAM : levelOf(bytes, lim->caches);
+  double gbs = bytes / (s.median * 1e3);
+  double gflops = flops / (s.median * 1e3);
+  double intensity = flops / bytes;
+  double stream = lim->stream[level][threadIdx];
+  double peak = lim->peak[threadIdx];
+  double roof = (intensity * stream < peak) ? intensity * stream : peak;
+
+  char name[64];
+  if(call->variant == V_SIMD){
+    snprintf(name, sizeof(name), "%s-%s%s", variantNames[call->variant], gemvIsaName(), suffix);
+  }else{
+    snprintf(name, sizeof(name), "%s%s", variantNames[call->variant], suffix);
+  }
+  fprintf(file,"%s,%s,%d,%d,%d,%d,%zu,%g,%g,%g,%.3f,%.3f,%.4f,%.3f,%.3f,%.3f,%.1f,",name,levelNames[level],
+          call->rows,call->pt->cols,call->numThreads,flush,bytes,s.median,s.min,s.max,gbs,gflops,intensity,stream,
+          peak,roof,100 * gflops / roof);
+  //strong: same problem, p threads should take 1/p of the time. weak: p times the rows on p threads, same time
+  if(t1 >= 0) fprintf(file,"%.3f", (t1 > 0) ? t1 / (call->numThreads * s.median) : 1.0);
+  fprintf(file,",");
+  if(weakT1 >= 0) fprintf(file,"%.3f", (weakT1 > 0) ? weakT1 / s.median : 1.0);
+  fprintf(file,"\n");
+  fflush(file);
+  return s.median;
+}
+
+//every variant on one square size, across the thread counts
+static void sweepPoint(FILE* file, Point* pt, const Ceilings* lim){
+  for(int v = 0; v < NUM_VARIANTS; v++){
+    if(prepareVariant((Variant)v, pt) != 0){
+      fprintf(stderr, "%s skipped at n = %d\n", variantNames[v], pt->rows);
+      releaseVariant((Variant)v, pt);
+      continue;
+    }
+    Call call = {(Variant)v, pt, pt->rows, 1};
+    BenchRegion regions[8];
+    double flops;
+    size_t bytes = 0;
+    int numRegions = callRegions(&call, regions, &flops);
+    for(int r = 0; r < numRegions; r++) bytes += regions[r].bytes;
+    //past the last level cache the end of one pass would still be cached at the start of the next
+    int flush = (levelOf(bytes, lim->caches) == LEVEL_DRAM);
+
+    double t1 = serialVariant((Variant)v) ? -1 : 0;
+    for(int j = 0; j < NUM_THREAD_COUNTS; j++){
+      if(serialVariant((Variant)v) && j > 0) break;
+      call.numThreads = threadCounts[j];
+      double t = measure(file, &call, "", flush, lim, j, t1, -1);
+      if(j == 0 && t1 == 0) t1 = t;
+    }
+    releaseVariant((Variant)v, pt);
+  }
+}
+
+//weak scaling on the DRAM point: p threads get the leading p/8 of A's rows, so every thread count has the same
+//rows per thread. always flushed, so the smaller problems do not get to run from cache
+static void weakScaling(FILE* file, Point* pt, const Ceilings* lim){
+  Variant weakVariants[5] = {V_WEAK, V_STRONG, V_SIMD, V_TRANSPOSE, V_2D};
+  int maxThreads = threadCounts[NUM_THREAD_COUNTS - 1];
+  int rowsPerThread = pt->rows / maxThreads;
+  for(int v = 0; v < 5; v++){
+    double weakT1 = 0;
+    for(int j = 0; j < NUM_THREAD_COUNTS; j++){
+      Call call = {weakVariants[v], pt, rowsPerThread * threadCounts[j], threadCounts[j]};
+      double t = measure(file, &call, "-weak", 1, lim, j, -1, weakT1);
+      if(j == 0) weakT1 = t;
+    }
+  }
+}
+
+static int squareSide(size_t bytes){
+  int n = (int)sqrt((double)bytes / sizeof(float));
+  n &= ~15;
+  return (n < 16) ? 16 : n;
+}
+
+int main(int argc, char** argv){
+  if(argc > 2){
+    fprintf(stderr,"Usage: %s [dramMB]\n", argv[0]);
+    return 1;
+  }
+
+  Ceilings lim;
+  memset(&lim, 0, sizeof(lim));
+  lim.caches = benchCacheSizes();
+  //half of each cache for the cache levels, so x, y and stray lines fit beside A. DRAM at 4x the last level cache,
+  //the STREAM sizing rule, but no more than a quarter of physical memory
+  lim.levelBytes[LEVEL_L1] = lim.caches.l1 / 2;
+  lim.levelBytes[LEVEL_L2] = lim.caches.l2 / 2;
+  lim.levelBytes[LEVEL_L3] = lim.caches.l3 / 2;
+  size_t dram = 4 * lim.caches.l3;
+  long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGE_SIZE);
+  if(pages > 0 && pageSize > 0 && dram > (size_t)pages * pageSize / 4) dram = (size_t)pages * pageSize / 4;
+  if(argc == 2) dram = (size_t)atol(argv[1]) << 20;
+  lim.levelBytes[LEVEL_DRAM] = dram;
+
+  FILE* file = fopen("ceilings.csv", "w");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open file %s for writing\n", "ceilings.csv");
+    exit(EXIT_FAILURE);
+  }
+  fprintf(file,"Ceiling,Level,NumberThreads,Footprint (bytes),Value,Unit\n");
+  for(int j = 0; j < NUM_THREAD_COUNTS; j++){
+    lim.peak[j] = benchPeakFlops(threadCounts[j]);
+    fprintf(file,"PeakFma,,%d,0,%.3f,GFLOP/s\n",threadCounts[j],lim.peak[j]);
+    for(int l = 0; l < NUM_LEVELS; l++){
+      lim.stream[l][j] = benchStream(lim.levelBytes[l],threadCounts[j]);
+      fprintf(file,"StreamTriad,%s,%d,%zu,%.3f,GB/s\n",levelNames[l],threadCounts[j],lim.levelBytes[l],
+              lim.stream[l][j]);
+    }
+  }
+  fclose(file);
+
+  file = fopen("roofline.csv", "w");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open file %s for writing\n", "roofline.csv");
+    exit(EXIT_FAILURE);
+  }
+  fprintf(file,"Experiment,Level,Rows,Cols,NumberThreads,Flushed,Footprint (bytes),Median (us),Min (us),Max (us),"
+               "GB/s,GFLOP/s,Flop/Byte,Stream GB/s,Peak GFLOP/s,Roof GFLOP/s,Roof %%,StrongEff,WeakEff\n");
+
+  for(int l = 0; l < NUM_LEVELS; l++){
+    int n = squareSide(lim.levelBytes[l]);
+    Point pt;
+    memset(&pt, 0, sizeof(pt));
+    pt.rows = pt.cols = n;
+    pt.A = createMatrix(n,n);
+    pt.x = createMatrix(n,1);
+    pt.y = createMatrix(n,1);
+    pt.X = createMatrix(n,64);
+    pt.Y = createMatrix(n,64);
+    if(pt.A == NULL || pt.x == NULL || pt.y == NULL || pt.X == NULL || pt.Y == NULL){
+      fprintf(stderr, "%s point (n = %d) skipped\n", levelNames[l], n);
+    }else{
+      initMatrixParallel(pt.A,n,n,threadCounts[NUM_THREAD_COUNTS - 1]);
+      initMatrix(pt.x,n,1);
+      memset(pt.y, 0, n * sizeof(pt.y[0]));
+      initMatrix(pt.X,n,64);
+      memset(pt.Y, 0, (size_t)n * 64 * sizeof(pt.Y[0]));
+      sweepPoint(file, &pt, &lim);
+      if(l == LEVEL_DRAM) weakScaling(file, &pt, &lim);
+    }
+    freeMatrix(pt.A);
+    freeMatrix(pt.x);
+    freeMatrix(pt.y);
+    freeMatrix(pt.X);
+    freeMatrix(pt.Y);
+  }
+  fclose(file);
+
+  return 0;
+}
@@ -0,0 +1,356 @@
+//sparse formats and SpMV. CSR is the general format and what the loaders produce; SELL-C-sigma is built from CSR
+//and trades a little padding for rows that line up in SIMD registers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <immintrin.h>
+#include <omp.h>
+#include "sparse.h"
+#include "gemv.h"
+
+static CsrMatrix* csrAlloc(int rows, int cols, long nnz){
+  CsrMatrix* M = (CsrMatrix*)calloc(1, sizeof(CsrMatrix));
+  if(M == NULL) return NULL;
+  M->rows = rows;
+  M->cols = cols;
+  M->nnz = nnz;
+  M->rowPtr = (long*)malloc(((size_t)rows + 1) * sizeof(long));
+  //one extra element so an empty matrix still gets non-NULL arrays
+  M->colIdx = (int*)malloc(((size_t)nnz + 1) * sizeof(int));
+  M->val = (float*)malloc(((size_t)nnz + 1) * sizeof(float));
+  if(M->rowPtr == NULL || M->colIdx == NULL || M->val == NULL){
+    freeCsr(M);
+    return NULL;
+  }
+  return M;
+}
+
+void freeCsr(CsrMatrix* M){
+  if(M == NULL) return;
+  free(M->rowPtr);
+  free(M->colIdx);
+  free(M->val);
+  free(M);
+}
+
+CsrMatrix* csrFromDense(Matrix A, int rows, int cols){
+  long nnz = 0;
+  for(size_t i = 0; i < (size_t)rows * cols; i++){
+    if(A[i] != 0) nnz++;
+  }
+  CsrMatrix* M = csrAlloc(rows, cols, nnz);
+  if(M == NULL){
+    fprintf(stderr, "Sparse allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    return NULL;
+  }
+  long k = 0;
+  for(int i = 0; i < rows; i++){
+    M->rowPtr[i] = k;
+    const float* a = A + (size_t)i * cols;
+    for(int j = 0; j < cols; j++){
+      if(a[j] != 0){
+        M->colIdx[k] = j;
+        M->val[k] = a[j];
+        k++;
+      }
+    }
+  }
+  M->rowPtr[rows] = k;
+  return M;
+}
+
+Matrix csrToDense(const CsrMatrix* M){
+  Matrix A = createMatrix(M->rows, M->cols);
+  if(A == NULL) return NULL;
+  memset(A, 0, (size_t)M->rows * M->cols * sizeof(A[0]));
+  for(int i = 0; i < M->rows; i++){
+    for(long k = M->rowPtr[i]; k < M->rowPtr[i + 1]; k++){
+      A[(size_t)i * M->cols + M->colIdx[k]] = M->val[k];
+    }
+  }
+  return A;
+}
+
+typedef struct {
+  int row, col;
+  float val;
+} Triplet;
+
+static int compareTriplet(const void* a, const void* b){
+  const Triplet* x = (const Triplet*)a;
+  const Triplet* y = (const Triplet*)b;
+  if(x->row != y->row) return (x->row < y->row) ? -1 : 1;
+  if(x->col != y->col) return (x->col < y->col) ? -1 : 1;
+  return 0;
+}
+
+CsrMatrix* csrLoad(const char* path){
+  FILE* file = fopen(path, "r");
+  if(file == NULL){
+    fprintf(stderr, "Could not open file %s for reading\n", path);
+    return NULL;
+  }
+
+  char line[1024], object[64], format[64], field[64], symmetry[64];
+  if(fgets(line, sizeof(line), file) == NULL ||
+     sscanf(line, "%%%%MatrixMarket %63s %63s %63s %63s", object, format, field, symmetry) != 4 ||
+     strcasecmp(object, "matrix") != 0 || strcasecmp(format, "coordinate") != 0){
+    fprintf(stderr, "%s: not a Matrix Market coordinate file\n", path);
+    fclose(file);
+    return NULL;
+  }
+  int pattern = (strcasecmp(field, "pattern") == 0);
+  if(!pattern && strcasecmp(field, "real") != 0 && strcasecmp(field, "integer") != 0){
+    fprintf(stderr, "%s: unsupported field type %s\n", path, field);
+    fclose(file);
+    return NULL;
+  }
+  int symmetric = (strcasecmp(symmetry, "symmetric") == 0);
+  if(!symmetric && strcasecmp(symmetry, "general") != 0){
+    fprintf(stderr, "%s: unsupported symmetry %s\n", path, symmetry);
+    fclose(file);
+    return NULL;
+  }
+
+  //comments run until the size line
+  int rows = 0, cols = 0;
+  long entries = -1;
+  while(fgets(line, sizeof(line), file) != NULL){
+    if(line[0] == '%') continue;
+    if(sscanf(line, "%d %d %ld", &rows, &cols, &entries) != 3) entries = -1;
+    break;
+  }
+  if(entries < 0 || rows <= 0 || cols <= 0){
+    fprintf(stderr, "%s: missing or bad size line\n", path);
+    fclose(file);
+    return NULL;
+  }
+
+  //a symmetric file lists one triangle, so it can expand to twice as many entries
+  Triplet* t = (Triplet*)malloc(((size_t)entries * (symmetric ? 2 : 1) + 1) * sizeof(Triplet));
+  if(t == NULL){
+    fprintf(stderr, "Sparse allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    fclose(file);
+    return NULL;
+  }
+  long count = 0;
+  for(long e = 0; e < entries; e++){
+    int r, c;
+    double v = 1;
+    int ok = pattern ? (fscanf(file, "%d %d", &r, &c) == 2) : (fscanf(file, "%d %d %lf", &r, &c, &v) == 3);
+    if(!ok || r < 1 || r > rows || c < 1 || c > cols){
+      fprintf(stderr, "%s: bad entry %ld\n", path, e + 1);
+      free(t);
+      fclose(file);
+      return NULL;
+    }
+    //files are 1 based
+    t[count++] = (Triplet){r - 1, c - 1, (float)v};
+    if(symmetric && r != c) t[count++] = (Triplet){c - 1, r - 1, (float)v};
+  }
+  fclose(file);
+
+  qsort(t, count, sizeof(Triplet), compareTriplet);
+  CsrMatrix* M = csrAlloc(rows, cols, count);
+  if(M == NULL){
+    fprintf(stderr, "Sparse allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    free(t);
+    return NULL;
+  }
+  long k = 0;
+  for(int i = 0; i < rows; i++){
+    M->rowPtr[i] = k;
+    while(k < count && t[k].row == i){
+      M->colIdx[k] = t[k].col;
+      M->val[k] = t[k].val;
+      k++;
+    }
+  }
+  M->rowPtr[rows] = k;
+  free(t);
+  return M;
+}
+
+void freeSell(SellMatrix* S){
+  if(S == NULL) return;
+  free(S->chunkPtr);
+  free(S->chunkLen);
+  free(S->colIdx);
+  free(S->val);
+  free(S->perm);
+  free(S);
+}
+
+typedef struct {
+  int len, row;
+} RowLength;
+
+//longest first; ties keep row order so the permutation stays as close to identity as possible
+static int compareRowLength(const void* a, const void* b){
+  const RowLength* x = (const RowLength*)a;
+  const RowLength* y = (const RowLength*)b;
+  if(x->len != y->len) return (x->len > y->len) ? -1 : 1;
+  return (x->row < y->row) ? -1 : (x->row > y->row);
+}
+
+SellMatrix* sellFromCsr(const CsrMatrix* M, int sigma){
+  if(sigma < 1) sigma = 1;
+  int rows = M->rows;
+  int numChunks = (rows + SELL_C - 1) / SELL_C;
+  SellMatrix* S = (SellMatrix*)calloc(1, sizeof(SellMatrix));
+  RowLength* order = (RowLength*)malloc(((size_t)rows + 1) * sizeof(RowLength));
+  if(S == NULL || order == NULL){
+    fprintf(stderr, "Sparse allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    free(S);
+    free(order);
+    return NULL;
+  }
+  S->rows = rows;
+  S->cols = M->cols;
+  S->sigma = sigma;
+  S->numChunks = numChunks;
+  S->nnz = M->nnz;
+  S->chunkPtr = (long*)malloc(((size_t)numChunks + 1) * sizeof(long));
+  S->chunkLen = (int*)malloc(((size_t)numChunks + 1) * sizeof(int));
+  S->perm = (int*)malloc(((size_t)numChunks * SELL_C + 1) * sizeof(int));
+  if(S->chunkPtr == NULL || S->chunkLen == NULL || S->perm == NULL){
+    fprintf(stderr, "Sparse allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    free(order);
+    freeSell(S);
+    return NULL;
+  }
+
+  //sort by length inside each sigma window; sigma = 1 keeps the original order
+  for(int i = 0; i < rows; i++){
+    order[i].len = (int)(M->rowPtr[i + 1] - M->rowPtr[i]);
+    order[i].row = i;
+  }
+  for(int w = 0; w < rows; w += sigma){
+    int n = (w + sigma < rows) ? sigma : rows - w;
+    qsort(order + w, n, sizeof(RowLength), compareRowLength);
+  }
+
+  //padding rows of the last chunk point at row -1 and have length 0
+  long stored = 0;
+  for(int c = 0; c < numChunks; c++){
+    int len = 0;
+    for(int r = 0; r < SELL_C; r++){
+      int p = c * SELL_C + r;
+      S->perm[p] = (p < rows) ? order[p].row : -1;
+      if(p < rows && order[p].len > len) len = order[p].len;
+    }
+    S->chunkPtr[c] = stored;
+    S->chunkLen[c] = len;
+    stored += (long)len * SELL_C;
+  }
+  S->chunkPtr[numChunks] = stored;
+  S->stored = stored;
+  free(order);
+
+  S->colIdx = (int*)malloc(((size_t)stored + 1) * sizeof(int));
+  S->val = (float*)malloc(((size_t)stored + 1) * sizeof(float));
+  if(S->colIdx == NULL || S->val == NULL){
+    fprintf(stderr, "Sparse allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    freeSell(S);
+    return NULL;
+  }
+  for(int c = 0; c < numChunks; c++){
+    for(int r = 0; r < SELL_C; r++){
+      int row = S->perm[c * SELL_C + r];
+      long start = (row >= 0) ? M->rowPtr[row] : 0;
+      int len = (row >= 0) ? (int)(M->rowPtr[row + 1] - start) : 0;
+      //padding repeats the row's last column with a zero value, so it touches a line of x already in cache
+      int padCol = (len > 0) ? M->colIdx[start + len - 1] : 0;
+      for(int j = 0; j < S->chunkLen[c]; j++){
+        long at = S->chunkPtr[c] + (long)j * SELL_C + r;
+        S->colIdx[at] = (j < len) ? M->colIdx[start + j] : padCol;
+        S->val[at] = (j < len) ? M->val[start + j] : 0;
+      }
+    }
+  }
+  return S;
+}
+
+//first index i in [0, n] with ptr[i] >= target; ptr is a nondecreasing prefix sum with n + 1 entries
+static int lowerBound(const long* ptr, int n, long target){
+  int lo = 0, hi = n;
+  while(lo < hi){
+    int mid = lo + (hi - lo) / 2;
+    if(ptr[mid] < target) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+void spmvCsr(const CsrMatrix* M, Matrix x, Matrix y, int numThreads){
+#pragma omp parallel num_threads(numThreads)
+  {
+    int tid = omp_get_thread_num();
+    int nt = omp_get_num_threads();
+    //split points are taken on the nonzero count, so each range holds about nnz / nt entries
+    int row0 = lowerBound(M->rowPtr, M->rows, M->nnz * tid / nt);
+    int row1 = (tid == nt - 1) ? M->rows : lowerBound(M->rowPtr, M->rows, M->nnz * (tid + 1) / nt);
+    for(int i = row0; i < row1; i++){
+      float sum = 0;
+      for(long k = M->rowPtr[i]; k < M->rowPtr[i + 1]; k++){
+        sum += M->val[k] * x[M->colIdx[k]];
+      }
+      y[i] = sum;
+    }
+  }
+}
+
+//plain C chunk kernel: SELL_C independent sums, one per row of the chunk
+static void sellChunkScalar(const int* col, const float* val, int len, const float* x, float* acc){
+  for(int r = 0; r < SELL_C; r++){
+    acc[r] = 0;
+  }
+  for(int j = 0; j < len; j++){
+    for(int r = 0; r < SELL_C; r++){
+      acc[r] += val[j * SELL_C + r] * x[col[j * SELL_C + r]];
+    }
+  }
+}
+
+//one register holds the chunk's 8 rows: per column j, one load of the indices, one gather of x and one FMA. gcc
+//does not emit hardware gathers for the loop above when tuning for cores where they are slow, so it is spelled out
+__attribute__((target("avx2,fma")))
+static void sellChunkAvx2(const int* col, const float* val, int len, const float* x, float* acc){
+  __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+  int j = 0;
+  //two accumulators so consecutive gathers do not wait on each other's FMA
+  for(; j + 2 <= len; j += 2){
+    __m256i i0 = _mm256_loadu_si256((const __m256i*)(col + j * SELL_C));
+    __m256i i1 = _mm256_loadu_si256((const __m256i*)(col + (j + 1) * SELL_C));
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(val + j * SELL_C), _mm256_i32gather_ps(x, i0, 4), s0);
+    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(val + (j + 1) * SELL_C), _mm256_i32gather_ps(x, i1, 4), s1);
+  }
+  if(j < len){
+    __m256i i0 = _mm256_loadu_si256((const __m256i*)(col + j * SELL_C));
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(val + j * SELL_C), _mm256_i32gather_ps(x, i0, 4), s0);
+  }
+  _mm256_storeu_ps(acc, _mm256_add_ps(s0, s1));
+}
+
+void spmvSell(const SellMatrix* S, Matrix x, Matrix y, int numThreads){
+  //SELL_C = 8 matches one AVX register, which AVX-512 machines run just as well
+  void (*chunk)(const int*, const float*, int, const float*, float*) =
+    (gemvSelectedIsa() == ISA_SCALAR) ? sellChunkScalar : sellChunkAvx2;
+#pragma omp parallel num_threads(numThreads)
+  {
+    int tid = omp_get_thread_num();
+    int nt = omp_get_num_threads();
+    //balanced on stored entries, padding included, since that is what the kernel actually processes
+    int c0 = lowerBound(S->chunkPtr, S->numChunks, S->stored * tid / nt);
+    int c1 = (tid == nt - 1) ? S->numChunks : lowerBound(S->chunkPtr, S->numChunks, S->stored * (tid + 1) / nt);
+    float acc[SELL_C];
+    for(int c = c0; c < c1; c++){
+      chunk(S->colIdx + S->chunkPtr[c], S->val + S->chunkPtr[c], S->chunkLen[c], x, acc);
+      for(int r = 0; r < SELL_C; r++){
+        int row = S->perm[c * SELL_C + r];
+        if(row >= 0) y[row] = acc[r];
+      }
+    }
+  }
+}
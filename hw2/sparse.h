@@ -0,0 +1,51 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include "matrix.h"
+
+//compressed sparse row: the column indices and values of row i are colIdx/val[rowPtr[i] .. rowPtr[i+1])
+typedef struct {
+  int rows, cols;
+  long nnz;
+  long* rowPtr;
+  int* colIdx;
+  float* val;
+} CsrMatrix;
+
+//SELL-C-sigma: rows are sorted by length inside windows of sigma rows, then packed SELL_C at a time into chunks
+//padded to the chunk's longest row. a chunk is stored column major, so entry j of the chunk's row r sits at
+//chunkPtr[c] + j*SELL_C + r and one SIMD register covers the same position of SELL_C rows. perm maps a packed row
+//back to its row in the original matrix
+#define SELL_C 8
+//default sorting window: 32 chunks, wide enough to group similar rows, narrow enough that a chunk's rows stay close
+//together and share lines of x
+#define SELL_SIGMA 256
+
+typedef struct {
+  int rows, cols, sigma;
+  int numChunks;
+  long nnz;      //real nonzeros
+  long stored;   //nonzeros plus padding
+  long* chunkPtr;
+  int* chunkLen;
+  int* colIdx;
+  float* val;
+  int* perm;
+} SellMatrix;
+
+//builders return NULL (after a message on stderr) when allocation or parsing fails
+CsrMatrix* csrFromDense(Matrix A, int rows, int cols);
+//Matrix Market coordinate files: real, integer or pattern entries, general or symmetric
+CsrMatrix* csrLoad(const char* path);
+Matrix csrToDense(const CsrMatrix* M);
+void freeCsr(CsrMatrix* M);
+
+SellMatrix* sellFromCsr(const CsrMatrix* M, int sigma);
+void freeSell(SellMatrix* S);
+
+//y = M*x. threads get contiguous ranges holding about the same number of nonzeros rather than the same number of
+//rows, so a few long rows do not leave one thread with most of the work
+void spmvCsr(const CsrMatrix* M, Matrix x, Matrix y, int numThreads);
+void spmvSell(const SellMatrix* S, Matrix x, Matrix y, int numThreads);
+
+#endif
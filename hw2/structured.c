@@ -0,0 +1,225 @@
+//structured matrix vector products. with A[i][j] = gen[i + j],
+//  y[i] = sum_j gen[i + j] x[j] = sum_m gen[i + cols-1 - m] xr[m],   xr[m] = x[cols-1 - m]
+//which is entry i + cols-1 of the linear convolution gen * xr. a circular convolution of size N >= rows+cols-1
+//only wraps into entries below cols-1, so those indices are exact and N can be the next power of two
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "structured.h"
+
+static const char* structureNames[] = {
+  [STRUCT_HANKEL]   = "hankel",
+  [STRUCT_TOEPLITZ] = "toeplitz",
+};
+
+const char* structureName(StructureType type){
+  return structureNames[type];
+}
+
+StructuredMatrix* structuredFromGenerator(StructureType type, const float* gen, int rows, int cols){
+  size_t len = (size_t)rows + cols - 1;
+  StructuredMatrix* S = (StructuredMatrix*)calloc(1, sizeof(StructuredMatrix));
+  if(S != NULL) S->gen = (float*)malloc(len * sizeof(float));
+  if(S == NULL || S->gen == NULL){
+    fprintf(stderr, "Structured matrix allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    free(S);
+    return NULL;
+  }
+  S->type = type;
+  S->rows = rows;
+  S->cols = cols;
+  //Toeplitz row i is Hankel row rows-1-i of the reversed generator
+  for(size_t s = 0; s < len; s++){
+    S->gen[s] = (type == STRUCT_HANKEL) ? gen[s] : gen[len - 1 - s];
+  }
+  return S;
+}
+
+StructuredMatrix* structuredFromDense(Matrix A, int rows, int cols){
+  size_t len = (size_t)rows + cols - 1;
+  float* gen = (float*)malloc(len * sizeof(float));
+  if(gen == NULL){
+    fprintf(stderr, "Structured matrix allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    return NULL;
+  }
+
+  //Hankel: first row then last column give gen[i + j]; every entry must match
+  int hankel = 1;
+  for(int j = 0; j < cols; j++) gen[j] = A[j];
+  for(int i = 1; i < rows; i++) gen[i + cols - 1] = A[(size_t)i * cols + cols - 1];
+  for(int i = 0; i < rows && hankel; i++){
+    for(int j = 0; j < cols; j++){
+      if(A[(size_t)i * cols + j] != gen[i + j]){
+        hankel = 0;
+        break;
+      }
+    }
+  }
+  if(hankel){
+    StructuredMatrix* S = structuredFromGenerator(STRUCT_HANKEL, gen, rows, cols);
+    free(gen);
+    return S;
+  }
+
+  //Toeplitz: gen[i - j + cols-1], from the first row (reversed) then the first column
+  int toeplitz = 1;
+  for(int j = 0; j < cols; j++) gen[cols - 1 - j] = A[j];
+  for(int i = 1; i < rows; i++) gen[i + cols - 1] = A[(size_t)i * cols];
+  for(int i = 0; i < rows && toeplitz; i++){
+    for(int j = 0; j < cols; j++){
+      if(A[(size_t)i * cols + j] != gen[i - j + cols - 1]){
+        toeplitz = 0;
+        break;
+      }
+    }
+  }
+  StructuredMatrix* S = toeplitz ? structuredFromGenerator(STRUCT_TOEPLITZ, gen, rows, cols) : NULL;
+  free(gen);
+  return S;
+}
+
+void freeStructured(StructuredMatrix* S){
+  if(S == NULL) return;
+  free(S->gen);
+  free(S->genHat);
+  free(S->twiddle);
+  free(S->work);
+  free(S);
+}
+
+//in place radix-2 FFT of n interleaved complex doubles, called by every thread of an enclosing parallel region.
+//sign -1 is the forward transform, +1 the unscaled inverse. twiddle holds exp(-2 pi i k / n) for k < n/2
+static void fft(double* a, int n, const double* twiddle, int sign){
+#pragma omp for schedule(static)
+  for(int i = 0; i < n; i++){
+    int j = 0;
+    for(int bit = 1, r = i; bit < n; bit <<= 1, r >>= 1){
+      j = (j << 1) | (r & 1);
+    }
+    if(i < j){
+      double re = a[2 * i], im = a[2 * i + 1];
+      a[2 * i] = a[2 * j];
+      a[2 * i + 1] = a[2 * j + 1];
+      a[2 * j] = re;
+      a[2 * j + 1] = im;
+    }
+  }
+  //each stage's n/2 butterflies are independent; the implicit barrier of the loop separates stages
+  for(int len = 2; len <= n; len <<= 1){
+    int half = len / 2, step = n / len;
+#pragma omp for schedule(static)
+    for(int b = 0; b < n / 2; b++){
+      int k = b % half;
+      int i = (b / half) * len + k;
+      //the inverse uses the conjugate twiddles
+      double wr = twiddle[2 * k * step];
+      double wi = (sign < 0) ? twiddle[2 * k * step + 1] : -twiddle[2 * k * step + 1];
+      double* u = a + 2 * i;
+      double* v = a + 2 * (i + half);
+      double tr = v[0] * wr - v[1] * wi;
+      double ti = v[0] * wi + v[1] * wr;
+      v[0] = u[0] - tr;
+      v[1] = u[1] - ti;
+      u[0] += tr;
+      u[1] += ti;
+    }
+  }
+}
+
+//size the transform, fill the twiddles and transform gen once; later products only transform x and back
+static int structuredPrepareFft(StructuredMatrix* S, int numThreads){
+  if(S->genHat != NULL) return 0;
+  size_t len = (size_t)S->rows + S->cols - 1;
+  int n = 1;
+  while((size_t)n < len) n <<= 1;
+  S->fftSize = n;
+  S->genHat = (double*)malloc((size_t)2 * n * sizeof(double));
+  S->twiddle = (double*)malloc((size_t)n * sizeof(double));
+  S->work = (double*)malloc((size_t)2 * n * sizeof(double));
+  if(S->genHat == NULL || S->twiddle == NULL || S->work == NULL){
+    fprintf(stderr, "Structured matrix allocation failed in file %s, line %d\n", __FILE__, __LINE__);
+    free(S->genHat);
+    free(S->twiddle);
+    free(S->work);
+    S->genHat = S->twiddle = S->work = NULL;
+    return -1;
+  }
+  double* genHat = S->genHat;
+  double* twiddle = S->twiddle;
+  const float* gen = S->gen;
+#pragma omp parallel num_threads(numThreads)
+  {
+#pragma omp for schedule(static)
+    for(int k = 0; k < n / 2; k++){
+      twiddle[2 * k] = cos(-2.0 * M_PI * k / n);
+      twiddle[2 * k + 1] = sin(-2.0 * M_PI * k / n);
+    }
+#pragma omp for schedule(static)
+    for(int s = 0; s < n; s++){
+      genHat[2 * s] = ((size_t)s < len) ? gen[s] : 0;
+      genHat[2 * s + 1] = 0;
+    }
+    fft(genHat, n, twiddle, -1);
+  }
+  return 0;
+}
+
+static void structuredFft(StructuredMatrix* S, const float* x, float* y, int numThreads){
+  int n = S->fftSize, rows = S->rows, cols = S->cols;
+  int flip = (S->type == STRUCT_TOEPLITZ);
+  double* work = S->work;
+  const double* genHat = S->genHat;
+  const double* twiddle = S->twiddle;
+#pragma omp parallel num_threads(numThreads)
+  {
+#pragma omp for schedule(static)
+    for(int m = 0; m < n; m++){
+      work[2 * m] = (m < cols) ? x[cols - 1 - m] : 0;
+      work[2 * m + 1] = 0;
+    }
+    fft(work, n, twiddle, -1);
+#pragma omp for schedule(static)
+    for(int k = 0; k < n; k++){
+      double ar = work[2 * k], ai = work[2 * k + 1];
+      double br = genHat[2 * k], bi = genHat[2 * k + 1];
+      work[2 * k] = ar * br - ai * bi;
+      work[2 * k + 1] = ar * bi + ai * br;
+    }
+    fft(work, n, twiddle, 1);
+#pragma omp for schedule(static)
+    for(int i = 0; i < rows; i++){
+      float v = (float)(work[2 * ((size_t)i + cols - 1)] / n);
+      y[flip ? rows - 1 - i : i] = v;
+    }
+  }
+}
+
+//row i reads the window gen[i .. i + cols), which slides by one element per row and so stays in cache
+static void structuredDirect(const StructuredMatrix* S, const float* x, float* y, int numThreads){
+  int rows = S->rows, cols = S->cols;
+  int flip = (S->type == STRUCT_TOEPLITZ);
+  const float* gen = S->gen;
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+  for(int i = 0; i < rows; i++){
+    const float* g = gen + i;
+    float s = 0;
+#pragma omp simd reduction(+:s)
+    for(int j = 0; j < cols; j++){
+      s += g[j] * x[j];
+    }
+    y[flip ? rows - 1 - i : i] = s;
+  }
+}
+
+void structuredGemv(StructuredMatrix* S, Matrix x, Matrix y, StructuredMode mode, int numThreads){
+  if(mode == STRUCT_AUTO){
+    mode = ((long)S->rows + S->cols - 1 < STRUCT_FFT_CROSSOVER) ? STRUCT_DIRECT : STRUCT_FFT;
+  }
+  if(mode == STRUCT_FFT && structuredPrepareFft(S, numThreads) == 0){
+    structuredFft(S, x, y, numThreads);
+  }else{
+    structuredDirect(S, x, y, numThreads);
+  }
+}
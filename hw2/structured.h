@@ -0,0 +1,42 @@
+#ifndef STRUCTURED_H
+#define STRUCTURED_H
+
+#include "matrix.h"
+
+//Hankel (A[i][j] depends on i+j) and Toeplitz (on i-j) operators kept as their rows+cols-1 generator values
+//instead of rows*cols entries. both are stored in Hankel form, A[i][j] = gen[i + j]; a Toeplitz matrix is a Hankel
+//one with its rows in reverse order, so it is kept that way and flipped back on output
+typedef enum { STRUCT_HANKEL, STRUCT_TOEPLITZ } StructureType;
+
+//DIRECT generates each row from gen on the fly, O(rows*cols) work but only O(rows+cols) memory traffic. FFT
+//embeds the product in a circular convolution, O(n log n). AUTO picks by size
+typedef enum { STRUCT_AUTO, STRUCT_DIRECT, STRUCT_FFT } StructuredMode;
+
+//below this many generator values (rows+cols-1) the direct product beats the transforms; measured single threaded,
+//square n = 1024 runs direct in about half the FFT time and n = 2048 in about 1.2x
+#define STRUCT_FFT_CROSSOVER 3072
+
+typedef struct {
+  StructureType type;
+  int rows, cols;
+  float* gen;
+  //FFT state, built on first FFT use: transform size, transform of gen, twiddles and one work buffer. the work
+  //buffer makes structuredGemv non reentrant for the same matrix
+  int fftSize;
+  double* genHat;
+  double* twiddle;
+  double* work;
+} StructuredMatrix;
+
+//for Hankel gen[s] is A[i][j] with i + j = s; for Toeplitz gen[s] is A[i][j] with i - j = s - (cols - 1).
+//returns NULL (after a message on stderr) if allocation fails
+StructuredMatrix* structuredFromGenerator(StructureType type, const float* gen, int rows, int cols);
+//checks whether a dense matrix is Hankel or Toeplitz (in that order) and extracts the generator; NULL if neither
+StructuredMatrix* structuredFromDense(Matrix A, int rows, int cols);
+void freeStructured(StructuredMatrix* S);
+const char* structureName(StructureType type);
+
+//y = A*x
+void structuredGemv(StructuredMatrix* S, Matrix x, Matrix y, StructuredMode mode, int numThreads);
+
+#endif
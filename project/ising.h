@@ -0,0 +1,46 @@
+#ifndef ISING_H
+#define ISING_H
+
+//public C API of libising.so. only what is declared here is exported; the engine headers are internal.
+//bump ISING_API_VERSION on any incompatible change
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ISING_API_VERSION 1
+
+#define ISING_API __attribute__((visibility("default")))
+
+//return codes
+#define ISING_OK 0
+#define ISING_EINVAL -1  //bad argument (size, count, null buffer, unknown engine)
+#define ISING_ENOMEM -2  //lattice allocation failed
+
+//version the library was built with; compare against ISING_API_VERSION
+ISING_API int ising_api_version(void);
+
+//engine id for a name such as "serial", "ordered", "taskparallel"; ISING_EINVAL if unknown
+ISING_API int ising_engine_lookup(const char *name);
+
+//run n_runs independent simulations on LxL lattices, run i at temperatures[i] for steps[i] single-site updates
+//starting from a random lattice drawn from seeds[i]. the final energy and magnetization per site of run i are
+//written to energy_out[i] and magnetization_out[i] (either may be NULL).
+//serial engines run the batch num_threads runs at a time; parallel engines run one after another with
+//num_threads threads each. block_size is passed to engines that take one (0 for default).
+//num_threads must be at most 256, and at most L/2 for parallel engines. kawasaki needs L to be a multiple of 4.
+//serial engines give the same result for the same seed; parallel engines may not (thread scheduling decides which
+//random numbers each site gets, and the naive engine races). the random streams are shared process wide, so do not
+//call this from several threads at once.
+//returns ISING_OK or a negative error code
+ISING_API int ising_run_batch(int L, int engine, int num_threads, int block_size, int n_runs,
+                              const double *temperatures, const uint64_t *seeds, const int *steps,
+                              double *energy_out, double *magnetization_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <omp.h>
+#include "ising.h"
+#include "ising_model.h"
+#include "ising_engines.h"
+#include "ising_rng.h"
+
+int ising_api_version(void){
+  return ISING_API_VERSION;
+}
+
+int ising_engine_lookup(const char *name){
+  if(name == NULL) return ISING_EINVAL;
+  int engine = engine_from_name(name);
+  return (engine < 0) ? ISING_EINVAL : engine;
+}
+
+static int **alloc_lattice(int L){
+  int** lattice = (int **)malloc(L * sizeof(int *));
+  if(lattice == NULL) return NULL;
+  for (int i = 0; i < L; i++) {
+    lattice[i] = (int *)malloc(L * sizeof(int));
+    if(lattice[i] == NULL){
+      for(int k = 0; k < i; k++) free(lattice[k]);
+      free(lattice);
+      return NULL;
+    }
+  }
+  return lattice;
+}
+
+static void free_lattice(int **lattice, int L){
+  if(lattice == NULL) return;
+  for (int i = 0; i < L; i++) {
+    free(lattice[i]);
+  }
+  free(lattice);
+}
+
+//one run on an already allocated lattice. the streams the engine draws from are reseeded first, so a serial engine
+//repeats a run exactly from its seed. parallel engines do not: naive races, taskparallel timeouts and the thread
+//schedule deciding which draws land on which sites make their results vary from run to run. the streams are global
+//and picked by OpenMP thread id, so two batches running at once in one process share them
+static void run_one(int **lattice, int L, int engine, int num_threads, int block_size, double T, uint64_t seed, int steps,
+                    double *energy, double *magnetization){
+  if(engine_is_parallel(engine)){
+    rng_seed_all(seed);
+  }else{
+    rng_seed(rng_thread(), seed);
+  }
+  initialize_lattice(lattice, L);
+  run_engine(engine, lattice, L, T, steps, num_threads, block_size);
+
+  double sites = (double)L * L;
+  if(energy != NULL) *energy = lattice_energy(lattice, L) / sites;
+  if(magnetization != NULL) *magnetization = lattice_magnetization(lattice, L) / sites;
+}
+
+int ising_run_batch(int L, int engine, int num_threads, int block_size, int n_runs,
+                    const double *temperatures, const uint64_t *seeds, const int *steps,
+                    double *energy_out, double *magnetization_out){
+  if(L < 2 || n_runs < 0 || engine < 0 || engine >= ENGINE_COUNT || num_threads < 1) return ISING_EINVAL;
+  //one random stream per thread id, and the strip engines need at least two rows per thread
+  if(num_threads > RNG_MAX_THREADS) return ISING_EINVAL;
+  if(engine_is_parallel(engine) && num_threads > L / 2) return ISING_EINVAL;
+  if(!engine_supports_size(engine, L)) return ISING_EINVAL;
+  if(n_runs > 0 && (temperatures == NULL || seeds == NULL || steps == NULL)) return ISING_EINVAL;
+
+  if(engine_is_parallel(engine)){
+    int **lattice = alloc_lattice(L);
+    if(lattice == NULL) return ISING_ENOMEM;
+    for(int i = 0; i < n_runs; i++){
+      run_one(lattice, L, engine, num_threads, block_size, temperatures[i], seeds[i], steps[i],
+              energy_out ? &energy_out[i] : NULL, magnetization_out ? &magnetization_out[i] : NULL);
+    }
+    free_lattice(lattice, L);
+    return ISING_OK;
+  }
+
+  //serial engine: spread the runs over threads, each thread reusing one lattice for all of its runs
+  int ***lattices = (int ***)calloc(num_threads, sizeof(int **));
+  if(lattices == NULL) return ISING_ENOMEM;
+  int status = ISING_OK;
+  for(int t = 0; t < num_threads; t++){
+    lattices[t] = alloc_lattice(L);
+    if(lattices[t] == NULL) status = ISING_ENOMEM;
+  }
+  if(status == ISING_OK){
+    #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+    for(int i = 0; i < n_runs; i++){
+      run_one(lattices[omp_get_thread_num()], L, engine, 1, block_size, temperatures[i], seeds[i], steps[i],
+              energy_out ? &energy_out[i] : NULL, magnetization_out ? &magnetization_out[i] : NULL);
+    }
+  }
+  for(int t = 0; t < num_threads; t++){
+    free_lattice(lattices[t], L);
+  }
+  free(lattices);
+  return status;
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <omp.h>
+#include "microtime.h"
+#include "ising_model.h"
+#include "ising_autotune.h"
+
+//each candidate is timed for at least this long (us) so fast engines aren't measured on timer noise
+#define TUNE_MIN_TIME 20000.0
+//block sizes tried for engines that take one; 0 means untiled
+static const int tune_block_sizes[] = {0, 16, 32, 64, 128};
+#define TUNE_NUM_BLOCKS (int)(sizeof(tune_block_sizes) / sizeof(tune_block_sizes[0]))
+
+static const char *tuning_file(void){
+  const char *path = getenv("ISING_TUNING_FILE");
+  return path ? path : TUNING_FILE_DEFAULT;
+}
+
+//cpu model from /proc/cpuinfo plus the processor count, so a tuning made on one machine is never reused on another
+static void cpu_key(char *key, size_t len){
+  char model[256] = "unknown";
+  char line[512];
+  FILE *file = fopen("/proc/cpuinfo", "r");
+  if(file != NULL){
+    while(fgets(line, sizeof(line), file)){
+      if(strncmp(line, "model name", 10) == 0){
+        char *value = strchr(line, ':');
+        if(value != NULL){
+          value++;
+          while(*value == ' ') value++;
+          value[strcspn(value, "\n")] = '\0';
+          snprintf(model, sizeof(model), "%s", value);
+        }
+        break;
+      }
+    }
+    fclose(file);
+  }
+  snprintf(key, len, "%s (%d cpus)", model, omp_get_num_procs());
+}
+
+//tuning file format, one tab separated line per tuning: cpu, L, T, engine, threads, block, sweeps/sec
+//the last matching line wins so a forced retune simply appends
+static int load_tuning(const char *cpu, int L, const char *T_key, ising_tuning_t *best){
+  FILE *file = fopen(tuning_file(), "r");
+  if(file == NULL) return 0;
+
+  int found = 0;
+  char line[1024];
+  while(fgets(line, sizeof(line), file)){
+    line[strcspn(line, "\n")] = '\0';
+    char *fields[7];
+    int n = 0;
+    for(char *tok = strtok(line, "\t"); tok != NULL && n < 7; tok = strtok(NULL, "\t")){
+      fields[n++] = tok;
+    }
+    if(n != 7) continue;
+    if(strcmp(fields[0], cpu) != 0 || atoi(fields[1]) != L || strcmp(fields[2], T_key) != 0) continue;
+
+    int engine = engine_from_name(fields[3]);
+    if(engine < 0) continue;
+    best->engine = engine;
+    best->num_threads = atoi(fields[4]);
+    best->block_size = atoi(fields[5]);
+    best->sweeps_per_sec = atof(fields[6]);
+    found = 1;
+  }
+  fclose(file);
+  return found;
+}
+
+static void save_tuning(const char *cpu, int L, const char *T_key, const ising_tuning_t *best){
+  FILE *file = fopen(tuning_file(), "a");
+  if(file == NULL){
+    fprintf(stderr, "Could not open tuning file %s for appending\n", tuning_file());
+    return;
+  }
+  fprintf(file, "%s\t%d\t%s\t%s\t%d\t%d\t%f\n", cpu, L, T_key, engine_name(best->engine),
+          best->num_threads, best->block_size, best->sweeps_per_sec);
+  fclose(file);
+}
+
+//time one configuration from a fresh random lattice, doubling the step count until the run is long enough to trust.
+//the short early runs double as warmup
+static double measure(ising_engine_t engine, int num_threads, int block_size, int **lattice, int L, double T){
+  int steps = (L * L) / 4 > 0 ? (L * L) / 4 : 1;
+  double elapsed;
+  for(;;){
+    initialize_lattice(lattice, L);
+    double start = microtime();
+    run_engine(engine, lattice, L, T, steps, num_threads, block_size);
+    elapsed = microtime() - start;
+    if(elapsed >= TUNE_MIN_TIME || steps > INT_MAX / 2) break;
+    steps *= 2;
+  }
+  return sweeps_per_second(L, steps, elapsed);
+}
+
+//find the fastest engine/threads/block for this (L, T). uses the cached tuning for this cpu unless force is set.
+//returns 1 if the result came from the tuning file, 0 if it was measured now
+int ising_autotune(int L, double T, int force, ising_tuning_t *best){
+  char cpu[300];
+  char T_key[32];
+  cpu_key(cpu, sizeof(cpu));
+  snprintf(T_key, sizeof(T_key), "%.6g", T);
+
+  if(!force && load_tuning(cpu, L, T_key, best)){
+    return 1;
+  }
+
+  //thread counts: powers of two up to the core count, plus the core count itself.
+  //strip engines need at least two rows per thread
+  int max_threads = omp_get_num_procs();
+  if(max_threads > L / 2) max_threads = L / 2;
+  if(max_threads < 1) max_threads = 1;
+  int thread_counts[32];
+  int num_counts = 0;
+  for(int t = 1; t <= max_threads && num_counts < 31; t *= 2){
+    thread_counts[num_counts++] = t;
+  }
+  if(thread_counts[num_counts - 1] != max_threads){
+    thread_counts[num_counts++] = max_threads;
+  }
+
+  int** lattice = (int **)malloc(L * sizeof(int *));
+  for (int i = 0; i < L; i++) {
+    lattice[i] = (int *)malloc(L * sizeof(int));
+  }
+
+  best->sweeps_per_sec = -1;
+  for(int e = 0; e < ENGINE_COUNT; e++){
+    //sweeps/sec only means the same thing for engines whose steps are attempted single-site updates
+    if(!engine_is_race_free(e) || engine_conserves_magnetization(e) || !engine_counts_site_steps(e)) continue;
+    int n_threads = engine_is_parallel(e) ? num_counts : 1;
+    int n_blocks = engine_uses_block(e) ? TUNE_NUM_BLOCKS : 1;
+
+    for(int t = 0; t < n_threads; t++){
+      for(int b = 0; b < n_blocks; b++){
+        int num_threads = engine_is_parallel(e) ? thread_counts[t] : 1;
+        int block_size = engine_uses_block(e) ? tune_block_sizes[b] : 0;
+        if(block_size > L) continue;
+
+        double rate = measure(e, num_threads, block_size, lattice, L, T);
+        printf("Tune: %s threads %d block %d: %f sweeps/sec\n", engine_name(e), num_threads, block_size, rate);
+        if(rate > best->sweeps_per_sec){
+          best->engine = e;
+          best->num_threads = num_threads;
+          best->block_size = block_size;
+          best->sweeps_per_sec = rate;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < L; i++) {
+    free(lattice[i]);
+  }
+  free(lattice);
+
+  save_tuning(cpu, L, T_key, best);
+  return 0;
+}
+
+void run_tuned(const ising_tuning_t *tuning, int **lattice, int L, double T, int steps){
+  run_engine(tuning->engine, lattice, L, T, steps, tuning->num_threads, tuning->block_size);
+}
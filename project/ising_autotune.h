@@ -0,0 +1,20 @@
+#ifndef ISING_AUTOTUNE_H
+#define ISING_AUTOTUNE_H
+
+#include "ising_engines.h"
+
+//tuning file used when ISING_TUNING_FILE is not set
+#define TUNING_FILE_DEFAULT "ising_tuning.txt"
+
+//fastest configuration found for one (cpu, L, T)
+typedef struct {
+  ising_engine_t engine;
+  int num_threads;
+  int block_size;
+  double sweeps_per_sec;
+} ising_tuning_t;
+
+int ising_autotune(int L, double T, int force, ising_tuning_t *best);
+void run_tuned(const ising_tuning_t *tuning, int **lattice, int L, double T, int steps);
+
+#endif
@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "ising_correlation.h"
+
+int correlation_init(ising_correlation_t *c, int L){
+  int half = L / 2 + 1;
+  c->L = L;
+  c->samples = 0;
+  c->sum_abs_m = 0;
+  //2L bits plus a spare word for the unaligned read past the end
+  c->packed_words = (2 * L + 63) / 64 + 1;
+  c->g = (double *)calloc(half, sizeof(double));
+  c->sk = (double *)calloc((size_t)L * half, sizeof(double));
+  c->packed_rows = (uint64_t *)calloc((size_t)L * c->packed_words, sizeof(uint64_t));
+  c->packed_cols = (uint64_t *)calloc((size_t)L * c->packed_words, sizeof(uint64_t));
+  c->rows_hat = (double complex *)malloc((size_t)L * half * sizeof(double complex));
+  if(c->g == NULL || c->sk == NULL || c->packed_rows == NULL || c->packed_cols == NULL || c->rows_hat == NULL){
+    correlation_free(c);
+    return -1;
+  }
+  return 0;
+}
+
+void correlation_free(ising_correlation_t *c){
+  free(c->g);
+  free(c->sk);
+  free(c->packed_rows);
+  free(c->packed_cols);
+  free(c->rows_hat);
+  c->g = c->sk = NULL;
+  c->packed_rows = c->packed_cols = NULL;
+  c->rows_hat = NULL;
+}
+
+//sum over y of s(y) s(y+r) for one bit-packed line (bit set = spin up, stored twice so bit y+L == bit y).
+//s s' = 1 - 2 (b xor b'), so the sum is L minus twice the popcount of the line xor'd with its shifted self
+static long shifted_product_sum(const uint64_t *bits, int L, int r){
+  int words = (L + 63) / 64;
+  int q = r / 64, off = r % 64;
+  long differ = 0;
+  for(int w = 0; w < words; w++){
+    uint64_t shifted = off ? (bits[w + q] >> off) | (bits[w + q + 1] << (64 - off)) : bits[w + q];
+    uint64_t x = bits[w] ^ shifted;
+    if(w == words - 1 && L % 64) x &= (1ULL << (L % 64)) - 1;
+    differ += __builtin_popcountll(x);
+  }
+  return L - 2 * differ;
+}
+
+//in-place complex transform, exp(-2 pi i k x / n). radix-2 for powers of two, plain DFT through tmp otherwise
+static void fft(double complex *a, int n, double complex *tmp){
+  if((n & (n - 1)) != 0){
+    for(int k = 0; k < n; k++){
+      double complex sum = 0;
+      for(int x = 0; x < n; x++){
+        sum += a[x] * cexp(-2.0 * M_PI * I * (double)((long)k * x % n) / n);
+      }
+      tmp[k] = sum;
+    }
+    memcpy(a, tmp, n * sizeof(double complex));
+    return;
+  }
+
+  //bit reversal permutation
+  for(int i = 1, j = 0; i < n; i++){
+    int bit = n >> 1;
+    for(; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if(i < j){
+      double complex t = a[i];
+      a[i] = a[j];
+      a[j] = t;
+    }
+  }
+  for(int len = 2; len <= n; len <<= 1){
+    double complex w_len = cexp(-2.0 * M_PI * I / len);
+    for(int i = 0; i < n; i += len){
+      double complex w = 1;
+      for(int j = 0; j < len / 2; j++){
+        double complex u = a[i + j];
+        double complex v = a[i + j + len / 2] * w;
+        a[i + j] = u + v;
+        a[i + j + len / 2] = u - v;
+        w *= w_len;
+      }
+    }
+  }
+}
+
+//add the current configuration to the correlation and structure factor sums
+void correlation_record(ising_correlation_t *c, int **lattice, int num_threads){
+  int L = c->L;
+  int half = L / 2 + 1;
+  int pw = c->packed_words;
+  long magnetization = 0;
+
+  #pragma omp parallel num_threads(num_threads)
+  {
+    double complex *line = (double complex *)malloc(L * sizeof(double complex));
+    double complex *tmp = (double complex *)malloc(L * sizeof(double complex));
+    double *g_local = (double *)calloc(half, sizeof(double));
+
+    //pack every row and column twice over
+    #pragma omp for schedule(static) reduction(+:magnetization)
+    for(int x = 0; x < L; x++){
+      uint64_t *bits = c->packed_rows + (size_t)x * pw;
+      memset(bits, 0, pw * sizeof(uint64_t));
+      for(int y = 0; y < L; y++){
+        magnetization += lattice[x][y];
+        if(lattice[x][y] > 0){
+          bits[y >> 6] |= 1ULL << (y & 63);
+          bits[(y + L) >> 6] |= 1ULL << ((y + L) & 63);
+        }
+      }
+    }
+    #pragma omp for schedule(static)
+    for(int y = 0; y < L; y++){
+      uint64_t *bits = c->packed_cols + (size_t)y * pw;
+      memset(bits, 0, pw * sizeof(uint64_t));
+      for(int x = 0; x < L; x++){
+        if(lattice[x][y] > 0){
+          bits[x >> 6] |= 1ULL << (x & 63);
+          bits[(x + L) >> 6] |= 1ULL << ((x + L) & 63);
+        }
+      }
+    }
+
+    //G(r) from both directions
+    #pragma omp for schedule(static)
+    for(int line_index = 0; line_index < 2 * L; line_index++){
+      const uint64_t *bits = (line_index < L) ? c->packed_rows + (size_t)line_index * pw
+                                              : c->packed_cols + (size_t)(line_index - L) * pw;
+      for(int r = 0; r < half; r++){
+        g_local[r] += shifted_product_sum(bits, L, r);
+      }
+    }
+
+    //real transforms along the rows, two at a time: z = a + i b, then A_k = (Z_k + conj(Z_-k)) / 2 and
+    //B_k = (Z_k - conj(Z_-k)) / 2i. only ky = 0..L/2 is kept
+    #pragma omp for schedule(static)
+    for(int x = 0; x < L; x += 2){
+      int has_pair = (x + 1 < L);
+      for(int y = 0; y < L; y++){
+        line[y] = lattice[x][y] + (has_pair ? lattice[x + 1][y] * I : 0);
+      }
+      fft(line, L, tmp);
+      for(int k = 0; k < half; k++){
+        double complex z = line[k];
+        double complex z_neg = conj(line[(L - k) % L]);
+        c->rows_hat[(size_t)x * half + k] = 0.5 * (z + z_neg);
+        if(has_pair) c->rows_hat[(size_t)(x + 1) * half + k] = -0.5 * I * (z - z_neg);
+      }
+    }
+
+    //then complex transforms down the columns
+    #pragma omp for schedule(static)
+    for(int ky = 0; ky < half; ky++){
+      for(int x = 0; x < L; x++){
+        line[x] = c->rows_hat[(size_t)x * half + ky];
+      }
+      fft(line, L, tmp);
+      for(int kx = 0; kx < L; kx++){
+        double re = creal(line[kx]), im = cimag(line[kx]);
+        c->sk[(size_t)kx * half + ky] += (re * re + im * im) / ((double)L * L);
+      }
+    }
+
+    #pragma omp critical
+    {
+      for(int r = 0; r < half; r++){
+        c->g[r] += g_local[r] / (2.0 * L * L);
+      }
+    }
+    free(line);
+    free(tmp);
+    free(g_local);
+  }
+
+  c->sum_abs_m += fabs((double)magnetization) / ((double)L * L);
+  c->samples++;
+}
+
+//second moment correlation length from the smallest nonzero wavevector, averaged over both axes:
+//xi = sqrt(S(0)/S(k_min) - 1) / (2 sin(k_min/2)). returns 0 when undefined
+double correlation_length(const ising_correlation_t *c){
+  int L = c->L;
+  int half = L / 2 + 1;
+  if(c->samples == 0 || L < 2) return 0;
+  double s0 = c->sk[0];
+  double s1 = 0.5 * (c->sk[(size_t)1 * half] + c->sk[1]);
+  if(s1 <= 0 || s0 <= s1) return 0;
+  return sqrt(s0 / s1 - 1) / (2 * sin(M_PI / L));
+}
+
+//csv: G(r) and its connected part, then S(k) along the axes (kx and ky averaged) per sample
+void correlation_write(const ising_correlation_t *c, FILE *file){
+  int L = c->L;
+  int half = L / 2 + 1;
+  double n = c->samples ? (double)c->samples : 1;
+  double m = c->sum_abs_m / n;
+
+  fprintf(file, "r,G,G_connected\n");
+  for(int r = 0; r < half; r++){
+    fprintf(file, "%d,%f,%f\n", r, c->g[r] / n, c->g[r] / n - m * m);
+  }
+  fprintf(file, "k,S\n");
+  for(int k = 0; k < half; k++){
+    double s = 0.5 * (c->sk[(size_t)k * half] + c->sk[k]) / n;
+    fprintf(file, "%f,%f\n", 2 * M_PI * k / L, s);
+  }
+  fprintf(file, "xi,%f\n", correlation_length(c));
+}
@@ -0,0 +1,30 @@
+#ifndef ISING_CORRELATION_H
+#define ISING_CORRELATION_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <complex.h>
+
+//running sums of the spin-spin correlation function and the structure factor over sampled configurations.
+//g[r], r = 0..L/2, sums <s(x) s(x+r)> per site over rows and columns; sk[kx*(L/2+1) + ky] sums |S(k)|^2 / N for
+//kx = 0..L-1, ky = 0..L/2 (the other half follows from S(-k) = conj(S(k)))
+typedef struct {
+  int L;
+  long samples;
+  double sum_abs_m;
+  double *g;
+  double *sk;
+  //scratch: rows and columns bit-packed twice over so any cyclic shift is a contiguous read, and the row transforms
+  int packed_words;
+  uint64_t *packed_rows;
+  uint64_t *packed_cols;
+  double complex *rows_hat;
+} ising_correlation_t;
+
+int correlation_init(ising_correlation_t *c, int L);
+void correlation_free(ising_correlation_t *c);
+void correlation_record(ising_correlation_t *c, int **lattice, int num_threads);
+double correlation_length(const ising_correlation_t *c);
+void correlation_write(const ising_correlation_t *c, FILE *file);
+
+#endif
@@ -0,0 +1,55 @@
+#include <string.h>
+#include "ising_counters.h"
+
+#ifdef ISING_COUNTERS
+ising_thread_counters_t ising_counters[COUNTERS_MAX_THREADS];
+
+static const char *counter_names[COUNTER_COUNT] = {
+  [COUNTER_ATTEMPTS]          = "attempts",
+  [COUNTER_ACCEPTS]           = "accepts",
+  [COUNTER_LOCK_TIMEOUTS]     = "lock_timeouts",
+  [COUNTER_LOCK_BACKOFFS]     = "lock_backoffs",
+  [COUNTER_SIGNAL_COLLISIONS] = "signal_collisions",
+  [COUNTER_NAIVE_RACES]       = "naive_races",
+};
+#endif
+
+void counters_reset(void){
+#ifdef ISING_COUNTERS
+  memset(ising_counters, 0, sizeof(ising_counters));
+#endif
+}
+
+//totals and acceptance rate, then one line per thread that did any work. prints nothing when counters are compiled out
+void counters_print(FILE *file){
+#ifdef ISING_COUNTERS
+  unsigned long totals[COUNTER_COUNT] = {0};
+  for(int t = 0; t < COUNTERS_MAX_THREADS; t++){
+    for(int c = 0; c < COUNTER_COUNT; c++){
+      totals[c] += ising_counters[t].value[c];
+    }
+  }
+
+  fprintf(file, "Counters:");
+  for(int c = 0; c < COUNTER_COUNT; c++){
+    fprintf(file, " %s %lu", counter_names[c], totals[c]);
+  }
+  double acceptance = totals[COUNTER_ATTEMPTS] ? (double)totals[COUNTER_ACCEPTS] / totals[COUNTER_ATTEMPTS] : 0;
+  fprintf(file, " acceptance %f\n", acceptance);
+
+  for(int t = 0; t < COUNTERS_MAX_THREADS; t++){
+    int active = 0;
+    for(int c = 0; c < COUNTER_COUNT; c++){
+      active |= ising_counters[t].value[c] != 0;
+    }
+    if(!active) continue;
+    fprintf(file, "  thread %d:", t);
+    for(int c = 0; c < COUNTER_COUNT; c++){
+      fprintf(file, " %lu", ising_counters[t].value[c]);
+    }
+    fprintf(file, "\n");
+  }
+#else
+  (void)file;
+#endif
+}
@@ -0,0 +1,38 @@
+#ifndef ISING_COUNTERS_H
+#define ISING_COUNTERS_H
+
+#include <stdio.h>
+#include <omp.h>
+
+//runtime event counters, one padded set per OpenMP thread. build with 'make COUNTERS=1' to enable;
+//otherwise COUNT() compiles to nothing and the hot loops are unchanged
+typedef enum {
+  COUNTER_ATTEMPTS,          //single-site updates tried
+  COUNTER_ACCEPTS,           //spin flips accepted
+  COUNTER_LOCK_TIMEOUTS,     //locking_metropolis gave up after its timeout
+  COUNTER_LOCK_BACKOFFS,     //getLocks got some but not all five locks and released them
+  COUNTER_SIGNAL_COLLISIONS, //signal_metropolis found a vertically adjacent site in use
+  COUNTER_NAIVE_RACES,       //naive_metropolis read a neighbor another thread was updating
+  COUNTER_COUNT
+} ising_counter_t;
+
+#define COUNTERS_MAX_THREADS 256
+
+//padded to a cache line so threads never false-share their counters
+typedef struct {
+  unsigned long value[COUNTER_COUNT];
+} __attribute__((aligned(64))) ising_thread_counters_t;
+
+#ifdef ISING_COUNTERS
+extern ising_thread_counters_t ising_counters[COUNTERS_MAX_THREADS];
+#define COUNT(counter) (ising_counters[omp_get_thread_num()].value[counter]++)
+#define COUNT_ADD(counter, n) (ising_counters[omp_get_thread_num()].value[counter] += (n))
+#else
+#define COUNT(counter) ((void)0)
+#define COUNT_ADD(counter, n) ((void)0)
+#endif
+
+void counters_reset(void);
+void counters_print(FILE *file);
+
+#endif
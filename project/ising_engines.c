@@ -0,0 +1,128 @@
+#include <string.h>
+#include "ising_model.h"
+#include "ising_engines.h"
+#include "ising_sweep.h"
+#include "ising_openmp_taskparallel.h"
+#include "ising_openmp_dataparallel.h"
+#include "ising_nfold.h"
+#include "ising_temporal.h"
+#include "ising_kawasaki.h"
+#include "ising_hybrid.h"
+
+typedef struct {
+  const char *name;
+  int parallel;     //takes a thread count
+  int uses_block;   //takes a block/tile size
+  int race_free;    //safe to pick automatically; naive_metropolis updates neighbors without synchronization and
+                    //signal_metropolis only updates a strip boundary site when a neighbor is busy
+  int conserving;   //conserves magnetization, so it samples a different ensemble and is never a drop-in replacement
+  int site_steps;   //'steps' counts attempted single-site updates, so its rate compares with the others'. wolff
+                    //counts flipped spins, hybrid whole sweeps of mixed cluster and n-fold moves and kawasaki
+                    //whole sweeps of bond exchanges
+} engine_info_t;
+
+static const engine_info_t engine_table[ENGINE_COUNT] = {
+  [ENGINE_SERIAL]         = {"serial",         0, 0, 1, 0, 1},
+  [ENGINE_ORDERED]        = {"ordered",        0, 1, 1, 0, 1},
+  [ENGINE_NAIVE]          = {"naive",          1, 0, 0, 0, 1},
+  [ENGINE_TASKPARALLEL]   = {"taskparallel",   1, 0, 1, 0, 1},
+  [ENGINE_DATAPARALLEL]   = {"dataparallel",   1, 0, 1, 0, 1},
+  [ENGINE_SIGNALPARALLEL] = {"signalparallel", 1, 0, 0, 0, 1},
+  [ENGINE_NFOLD]          = {"nfold",          0, 0, 1, 0, 1},
+  [ENGINE_CHECKERBOARD]   = {"checkerboard",   1, 0, 1, 0, 1},
+  [ENGINE_TEMPORAL]       = {"temporal",       1, 1, 1, 0, 1},
+  [ENGINE_KAWASAKI]       = {"kawasaki",       1, 0, 1, 1, 0},
+  [ENGINE_WOLFF]          = {"wolff",          0, 0, 1, 0, 0},
+  [ENGINE_HYBRID]         = {"hybrid",         1, 0, 1, 0, 0},
+};
+
+const char *engine_name(ising_engine_t engine){
+  return engine_table[engine].name;
+}
+
+//returns -1 if the name is not a known engine
+int engine_from_name(const char *name){
+  for(int e = 0; e < ENGINE_COUNT; e++){
+    if(strcmp(engine_table[e].name, name) == 0) return e;
+  }
+  return -1;
+}
+
+int engine_is_parallel(ising_engine_t engine){
+  return engine_table[engine].parallel;
+}
+
+int engine_uses_block(ising_engine_t engine){
+  return engine_table[engine].uses_block;
+}
+
+int engine_is_race_free(ising_engine_t engine){
+  return engine_table[engine].race_free;
+}
+
+int engine_conserves_magnetization(ising_engine_t engine){
+  return engine_table[engine].conserving;
+}
+
+int engine_counts_site_steps(ising_engine_t engine){
+  return engine_table[engine].site_steps;
+}
+
+//kawasaki's bond coloring needs L to be a multiple of 4; every other engine takes any L >= 2
+int engine_supports_size(ising_engine_t engine, int L){
+  if(engine == ENGINE_KAWASAKI) return L % 4 == 0;
+  return 1;
+}
+
+//run 'steps' single-site updates with the chosen engine. num_threads/block_size are ignored by engines that don't take them.
+//returns 0, or -1 (after a message on stderr) if the engine cannot run on this lattice
+int run_engine(ising_engine_t engine, int **lattice, int L, double T, int steps, int num_threads, int block_size){
+  switch(engine){
+    case ENGINE_SERIAL:
+      serial_metropolis(lattice, L, T, steps);
+      break;
+    case ENGINE_ORDERED:
+      ordered_metropolis(lattice, L, T, steps, block_size);
+      break;
+    case ENGINE_NAIVE:
+      naive_metropolis(lattice, L, T, steps, num_threads);
+      break;
+    case ENGINE_TASKPARALLEL:
+      ising_openmp_taskparallel(lattice, L, T, steps, num_threads);
+      break;
+    case ENGINE_DATAPARALLEL:
+      ising_openmp_dataparallel(lattice, L, T, steps, num_threads);
+      break;
+    case ENGINE_SIGNALPARALLEL:
+      //every thread runs the steps it is given
+      ising_openmp_signalparallel(lattice, L, T, steps / num_threads, num_threads);
+      break;
+    case ENGINE_NFOLD:
+      nfold_metropolis(lattice, L, T, steps);
+      break;
+    case ENGINE_CHECKERBOARD:
+      //whole sweeps in parallel, then the leftover updates with the serial kernel so exactly 'steps' are made
+      checkerboard_metropolis(lattice, L, T, steps / (L * L), num_threads);
+      serial_metropolis(lattice, L, T, steps % (L * L));
+      break;
+    case ENGINE_TEMPORAL:
+      temporal_metropolis(lattice, L, T, steps, num_threads, block_size);
+      break;
+    case ENGINE_KAWASAKI:
+      //an exchange moves two spins, so there is no single-site kernel for the leftover: round up to whole sweeps
+      {
+        int sweeps = (int)(((long)steps + (long)L * L - 1) / ((long)L * L));
+        if(kawasaki_metropolis(lattice, L, T, sweeps, num_threads) < 0) return -1;
+      }
+      break;
+    case ENGINE_WOLFF:
+      wolff_metropolis(lattice, L, T, steps);
+      break;
+    case ENGINE_HYBRID:
+      hybrid_metropolis(lattice, L, T, steps, num_threads, NULL);
+      break;
+    default:
+      break;
+  }
+  return 0;
+}
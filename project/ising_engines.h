@@ -0,0 +1,31 @@
+#ifndef ISING_ENGINES_H
+#define ISING_ENGINES_H
+
+//every whole-lattice engine behind one call so drivers (autotuner, experiments) can pick one at runtime
+typedef enum {
+  ENGINE_SERIAL,
+  ENGINE_ORDERED,
+  ENGINE_NAIVE,
+  ENGINE_TASKPARALLEL,
+  ENGINE_DATAPARALLEL,
+  ENGINE_SIGNALPARALLEL,
+  ENGINE_NFOLD,
+  ENGINE_CHECKERBOARD,
+  ENGINE_TEMPORAL,
+  ENGINE_KAWASAKI,
+  ENGINE_WOLFF,
+  ENGINE_HYBRID,
+  ENGINE_COUNT
+} ising_engine_t;
+
+const char *engine_name(ising_engine_t engine);
+int engine_from_name(const char *name);
+int engine_is_parallel(ising_engine_t engine);
+int engine_uses_block(ising_engine_t engine);
+int engine_is_race_free(ising_engine_t engine);
+int engine_conserves_magnetization(ising_engine_t engine);
+int engine_counts_site_steps(ising_engine_t engine);
+int engine_supports_size(ising_engine_t engine, int L);
+int run_engine(ising_engine_t engine, int **lattice, int L, double T, int steps, int num_threads, int block_size);
+
+#endif
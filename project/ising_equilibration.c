@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <math.h>
+#include "ising_model.h"
+#include "ising_equilibration.h"
+
+//consecutive passing window comparisons before burn-in is declared over
+#define EQUIL_PASSES 3
+//production error is estimated from this many batch means
+#define NUM_BATCHES 16
+//minimum samples per batch before the production error estimate is trusted
+#define MIN_BATCH_SIZE 4
+
+void equilibration_defaults(equilibration_params_t *params){
+  params->sweeps_per_sample = 1;
+  params->window = 20;
+  params->tolerance = 2.0;
+  params->target_error = 1e-3;
+  params->max_sweeps = 100000;
+}
+
+//growable series of one observable
+typedef struct {
+  double *x;
+  int n;
+  int capacity;
+} series_t;
+
+static void series_push(series_t *s, double value){
+  if(s->n == s->capacity){
+    s->capacity = s->capacity ? 2 * s->capacity : 256;
+    s->x = (double *)realloc(s->x, s->capacity * sizeof(double));
+  }
+  s->x[s->n++] = value;
+}
+
+static void mean_var(const double *x, int n, double *mean, double *var){
+  double sum = 0, sum_sq = 0;
+  for(int i = 0; i < n; i++){
+    sum += x[i];
+  }
+  *mean = sum / n;
+  for(int i = 0; i < n; i++){
+    sum_sq += (x[i] - *mean) * (x[i] - *mean);
+  }
+  *var = (n > 1) ? sum_sq / (n - 1) : 0;
+}
+
+//does the series look stationary? compares the means of the last two windows of w samples against their combined
+//standard error. samples are autocorrelated so the error is underestimated, which only makes the test stricter
+static int windows_agree(const series_t *s, int w, double tolerance){
+  if(s->n < 2 * w) return 0;
+  double mean_old, var_old, mean_new, var_new;
+  mean_var(s->x + s->n - 2 * w, w, &mean_old, &var_old);
+  mean_var(s->x + s->n - w, w, &mean_new, &var_new);
+  double err = sqrt((var_old + var_new) / w);
+  //a frozen chain has zero variance and is stationary only if nothing moved
+  if(err == 0) return mean_old == mean_new;
+  return fabs(mean_new - mean_old) <= tolerance * err;
+}
+
+//mean and batch-means standard error, which stays honest for autocorrelated samples as long as batches are
+//longer than the autocorrelation time
+static void batch_stats(const series_t *s, double *mean, double *error){
+  double batch_means[NUM_BATCHES];
+  int batch = s->n / NUM_BATCHES;
+  double var;
+
+  if(s->n == 0){
+    *mean = 0;
+    *error = INFINITY;
+    return;
+  }
+  if(batch == 0){
+    mean_var(s->x, s->n, mean, &var);
+    *error = INFINITY;
+    return;
+  }
+  for(int b = 0; b < NUM_BATCHES; b++){
+    double sum = 0;
+    for(int i = b * batch; i < (b + 1) * batch; i++){
+      sum += s->x[i];
+    }
+    batch_means[b] = sum / batch;
+  }
+  mean_var(batch_means, NUM_BATCHES, mean, &var);
+  *error = sqrt(var / NUM_BATCHES);
+}
+
+static void measure(int **lattice, int L, series_t *energy, series_t *abs_mag){
+  double sites = (double)L * L;
+  series_push(energy, lattice_energy(lattice, L) / sites);
+  series_push(abs_mag, labs(lattice_magnetization(lattice, L)) / sites);
+}
+
+//burn in until the running energy and |m| are stationary, then run production only until the energy per site
+//is known to params->target_error. replaces guessing a fixed step count per temperature
+void run_until_equilibrated(int **lattice, int L, double T, ising_engine_t engine, int num_threads, int block_size,
+                            const equilibration_params_t *params, equilibration_result_t *result){
+  int steps = params->sweeps_per_sample * L * L;
+  long sweeps = 0;
+  int passes = 0;
+  series_t energy = {0}, abs_mag = {0};
+
+  result->equilibrated = 0;
+  while(sweeps < params->max_sweeps){
+    run_engine(engine, lattice, L, T, steps, num_threads, block_size);
+    sweeps += params->sweeps_per_sample;
+    measure(lattice, L, &energy, &abs_mag);
+
+    if(windows_agree(&energy, params->window, params->tolerance) && windows_agree(&abs_mag, params->window, params->tolerance)){
+      passes++;
+    }else{
+      passes = 0;
+    }
+    if(passes >= EQUIL_PASSES){
+      result->equilibrated = 1;
+      break;
+    }
+  }
+  result->burnin_sweeps = sweeps;
+
+  //production starts from an empty series so burn-in samples never bias the averages
+  if(result->equilibrated){
+    energy.n = 0;
+    abs_mag.n = 0;
+    while(sweeps < params->max_sweeps){
+      run_engine(engine, lattice, L, T, steps, num_threads, block_size);
+      sweeps += params->sweeps_per_sample;
+      measure(lattice, L, &energy, &abs_mag);
+
+      if(energy.n >= NUM_BATCHES * MIN_BATCH_SIZE && energy.n % NUM_BATCHES == 0){
+        double mean, error;
+        batch_stats(&energy, &mean, &error);
+        if(error < params->target_error) break;
+      }
+    }
+  }
+  result->production_sweeps = sweeps - result->burnin_sweeps;
+
+  //if burn-in never finished these are the statistics of the whole (non-stationary) run and should not be trusted
+  batch_stats(&energy, &result->energy, &result->energy_error);
+  batch_stats(&abs_mag, &result->abs_magnetization, &result->abs_magnetization_error);
+
+  free(energy.x);
+  free(abs_mag.x);
+}
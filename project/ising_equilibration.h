@@ -0,0 +1,28 @@
+#ifndef ISING_EQUILIBRATION_H
+#define ISING_EQUILIBRATION_H
+
+#include "ising_engines.h"
+
+typedef struct {
+  int sweeps_per_sample;  //sweeps between measurements of energy and |m|
+  int window;             //samples in each of the two windows whose means are compared
+  double tolerance;       //allowed gap between window means, in combined standard errors
+  double target_error;    //production stops once the standard error of energy per site is below this
+  long max_sweeps;        //cap on burn-in plus production
+} equilibration_params_t;
+
+typedef struct {
+  int equilibrated;       //0 if max_sweeps ran out during burn-in
+  long burnin_sweeps;
+  long production_sweeps;
+  double energy;          //per site
+  double energy_error;
+  double abs_magnetization;  //per site
+  double abs_magnetization_error;
+} equilibration_result_t;
+
+void equilibration_defaults(equilibration_params_t *params);
+void run_until_equilibrated(int **lattice, int L, double T, ising_engine_t engine, int num_threads, int block_size,
+                            const equilibration_params_t *params, equilibration_result_t *result);
+
+#endif
@@ -2,16 +2,60 @@
 //3 tasks include
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
+#include <unistd.h>
 #include "microtime.h"
 #include "ising_model.h"
+#include "ising_rng.h"
 #include "ising_openmp_taskparallel.h"
 #include "ising_openmp_dataparallel.h"
+#include "ising_sweep.h"
+#include "ising_autotune.h"
+#include "ising_mmap.h"
+#include "ising_equilibration.h"
+#include "ising_counters.h"
+#include "ising_reweight.h"
+#include "ising_nfold.h"
+#include "ising_temporal.h"
+#include "ising_correlation.h"
+#include "ising_kawasaki.h"
+#include "ising_potts.h"
+#include "ising_hybrid.h"
 
-int main() {
-    srand(time(NULL));
+int main(int argc, char** argv) {
+    rng_seed_all(time(NULL));
     
+    //out-of-core mode: lattice lives bit-packed in a memory-mapped file and is swept in row bands
+    //usage: --mmap file L sweeps band_rows. an existing file is reused (L is then ignored), otherwise it is created
+    if(argc > 1 && strcmp(argv[1], "--mmap") == 0){
+      if(argc != 6){
+        fprintf(stderr, "Usage: %s --mmap file L sweeps band_rows\n", argv[0]);
+        return 1;
+      }
+      long mmap_L = atol(argv[3]);
+      long sweeps = atol(argv[4]);
+      long band_rows = atol(argv[5]);
+      double mmap_T = 2.2;
+      mmap_lattice_t lat;
+      if(access(argv[2], F_OK) == 0){
+        if(mmap_lattice_open(&lat, argv[2]) != 0) return 1;
+      }else{
+        if(mmap_lattice_create(&lat, argv[2], mmap_L, band_rows) != 0) return 1;
+      }
+      printf("Lattice %ld x %ld, band rows %ld\n", lat.L, lat.L, band_rows);
+
+      double mmap_start = microtime();
+      mmap_ordered_metropolis(&lat, mmap_T, sweeps, band_rows);
+      double mmap_end = microtime();
+      printf("Run Time: %f\n", mmap_end - mmap_start);
+      printf("Sweeps/sec: %f\n", sweeps / ((mmap_end - mmap_start) * 1e-6));
+      printf("Magnetization: %f\n", mmap_lattice_magnetization(&lat, band_rows));
+      mmap_lattice_close(&lat);
+      return 0;
+    }
+
     //size of square 2d lattice
     int L = 64;
     //printf("Please enter the size L of a desired LxL Lattice: \n");
@@ -41,6 +85,119 @@ int main() {
     
     initialize_lattice(lattice,L);
 
+    //autotune mode: benchmark the engines for this L and T (or load the cached choice for this cpu) and run with the winner
+    //--retune ignores the tuning file and measures again
+    if(argc > 1 && (strcmp(argv[1], "--autotune") == 0 || strcmp(argv[1], "--retune") == 0)){
+      ising_tuning_t tuning;
+      int cached = ising_autotune(L, T, strcmp(argv[1], "--retune") == 0, &tuning);
+      printf("%s tuning: %s, threads %d, block %d (%f sweeps/sec)\n", cached ? "Cached" : "Measured",
+             engine_name(tuning.engine), tuning.num_threads, tuning.block_size, tuning.sweeps_per_sec);
+
+      counters_reset();
+      start = microtime();
+      run_tuned(&tuning, lattice, L, T, STEPS);
+      end = microtime();
+      printf("Run Time: %f\n", end - start);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, end - start));
+      counters_print(stdout);
+      return 0;
+    }
+
+    //equilibration mode: instead of a fixed STEPS, burn in until energy and |m| are stationary and then run
+    //production only until the energy is known to the target error. usage: --equilibrate [engine] [T]
+    if(argc > 1 && strcmp(argv[1], "--equilibrate") == 0){
+      int engine = (argc > 2) ? engine_from_name(argv[2]) : ENGINE_ORDERED;
+      if(engine < 0){
+        fprintf(stderr, "Unknown engine %s\n", argv[2]);
+        return 1;
+      }
+      if(argc > 3) T = atof(argv[3]);
+      equilibration_params_t params;
+      equilibration_result_t result;
+      equilibration_defaults(&params);
+
+      counters_reset();
+      start = microtime();
+      run_until_equilibrated(lattice, L, T, engine, num_threads[3], 0, &params, &result);
+      end = microtime();
+      printf("Engine: %s T: %f\n", engine_name(engine), T);
+      printf("Equilibrated: %s\n", result.equilibrated ? "yes" : "no (max sweeps reached)");
+      printf("Burn-in sweeps: %ld\n", result.burnin_sweeps);
+      printf("Production sweeps: %ld\n", result.production_sweeps);
+      printf("Energy per site: %f +/- %f\n", result.energy, result.energy_error);
+      printf("|m| per site: %f +/- %f\n", result.abs_magnetization, result.abs_magnetization_error);
+      printf("Run Time: %f\n", end - start);
+      counters_print(stdout);
+      return 0;
+    }
+
+    //reweighting mode: one equilibrated production run per given temperature records energy histograms, then the
+    //multi-histogram method gives the observables on a dense temperature grid. usage: --reweight T1 T2 ...
+    if(argc > 2 && strcmp(argv[1], "--reweight") == 0){
+      int n_runs = argc - 2;
+      int samples = 10000;
+      int grid_points = 50;
+      ising_histogram_t *runs = (ising_histogram_t *)malloc(n_runs * sizeof(ising_histogram_t));
+      double T_lo = INFINITY, T_hi = -INFINITY;
+
+      equilibration_params_t params;
+      equilibration_result_t result;
+      equilibration_defaults(&params);
+      //only the burn-in detection is wanted here; production is the histogram run below
+      params.target_error = INFINITY;
+
+      for(int r = 0; r < n_runs; r++){
+        double run_T = atof(argv[r + 2]);
+        T_lo = fmin(T_lo, run_T);
+        T_hi = fmax(T_hi, run_T);
+        if(histogram_init(&runs[r], L, run_T) != 0){
+          fprintf(stderr, "Histogram allocation failed\n");
+          return 1;
+        }
+        initialize_lattice(lattice, L);
+        run_until_equilibrated(lattice, L, run_T, ENGINE_ORDERED, 1, 0, &params, &result);
+        histogram_sample(&runs[r], lattice, ENGINE_ORDERED, 1, 0, 1, samples);
+        fprintf(stderr, "T %f: burn-in %ld sweeps, %d samples\n", run_T, result.burnin_sweeps + result.production_sweeps, samples);
+      }
+
+      reweight_curve(runs, n_runs, T_lo, T_hi, grid_points, stdout);
+      for(int r = 0; r < n_runs; r++){
+        histogram_free(&runs[r]);
+      }
+      free(runs);
+      return 0;
+    }
+
+    //correlation mode: after burn-in, accumulate G(r) and S(k) every few sweeps instead of post-processing
+    //print_lattice dumps. usage: --correlation T [sweeps_between] [samples]
+    if(argc > 2 && strcmp(argv[1], "--correlation") == 0){
+      T = atof(argv[2]);
+      int sweeps_between = (argc > 3) ? atoi(argv[3]) : 5;
+      int samples = (argc > 4) ? atoi(argv[4]) : 1000;
+      ising_correlation_t corr;
+      if(correlation_init(&corr, L) != 0){
+        fprintf(stderr, "Correlation allocation failed\n");
+        return 1;
+      }
+      equilibration_params_t params;
+      equilibration_result_t result;
+      equilibration_defaults(&params);
+      params.target_error = INFINITY;
+      run_until_equilibrated(lattice, L, T, ENGINE_ORDERED, 1, 0, &params, &result);
+
+      double measure_time = 0;
+      for(int s = 0; s < samples; s++){
+        run_engine(ENGINE_ORDERED, lattice, L, T, sweeps_between * L * L, 1, 0);
+        start = microtime();
+        correlation_record(&corr, lattice, num_threads[3]);
+        measure_time += microtime() - start;
+      }
+      correlation_write(&corr, stdout);
+      fprintf(stderr, "Measurement time per sample: %f\n", measure_time / samples);
+      correlation_free(&corr);
+      return 0;
+    }
+
     //print initial configuration
     //printf("Initial Lattice:\n");
     print_lattice(lattice,L);
@@ -48,24 +205,158 @@ int main() {
     //simulate the Ising model using Metropolis algorithm
     //serial metropolis
 
+    counters_reset();
     start = microtime();
     serial_metropolis(lattice, L, T, STEPS);
     end = microtime();
     
     printf("Serial time: %f\n", end - start);
+    printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, end - start));
+    counters_print(stdout);
     print_lattice(lattice,L);
+    initialize_lattice(lattice,L);
+
+    //serial sweeps in deterministic order with prefetch of upcoming rows; same number of site updates as above
+    //block size 0 is plain typewriter order, otherwise the lattice is walked in column tiles of that width
+    printf("Ordered Sweep\n");
+    int block_sizes[] = {0, 16, 32};
+    for(int i = 0; i < 3; i++){
+      counters_reset();
+      start = microtime();
+      ordered_metropolis(lattice, L, T, STEPS, block_sizes[i]);
+      end = microtime();
+      time = end - start;
+      printf("Block size: %d\n", block_sizes[i]);
+      printf("Run Time: %f\n", time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      counters_print(stdout);
+      initialize_lattice(lattice,L);
+    }
     
+    //rejection-free n-fold way; only flips that happen are simulated, so it pays off as T drops and acceptance falls
+    printf("N-fold Way\n");
+    counters_reset();
+    start = microtime();
+    nfold_metropolis(lattice, L, T, STEPS);
+    end = microtime();
+    time = end - start;
+    printf("Run Time: %f\n", time);
+    printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+    counters_print(stdout);
+    initialize_lattice(lattice,L);
+
+    //checkerboard sweeps, plain and with temporal blocking: each tile of rows is advanced several half-sweeps
+    //while it is still in cache instead of streaming the whole lattice once per half-sweep
+    printf("Checkerboard\n");
+    for(int i = 0; i < 4; i++){
+      counters_reset();
+      start = microtime();
+      checkerboard_metropolis(lattice, L, T, STEPS / (L * L), num_threads[i]);
+      end = microtime();
+      time = end - start;
+      printf("Thread count: %d\n",num_threads[i]);
+      printf("Run Time: %f\n", time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      counters_print(stdout);
+      initialize_lattice(lattice,L);
+    }
+
+    printf("Temporal Blocking\n");
+    int tile_rows[] = {8, 16, 32};
+    for(int i = 0; i < 4; i++){
+      for(int j = 0; j < 3; j++){
+        counters_reset();
+        start = microtime();
+        temporal_metropolis(lattice, L, T, STEPS, num_threads[i], tile_rows[j]);
+        end = microtime();
+        time = end - start;
+        printf("Thread count: %d\n",num_threads[i]);
+        printf("Tile rows: %d\n", tile_rows[j]);
+        printf("Run Time: %f\n", time);
+        printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+        counters_print(stdout);
+        initialize_lattice(lattice,L);
+      }
+    }
+
+    //Kawasaki spin exchange at fixed magnetization zero; bonds are updated one color at a time in parallel
+    printf("Kawasaki Exchange\n");
+    for(int i = 0; i < 4; i++){
+      initialize_lattice_fixed(lattice, L, (long)L * L / 2);
+      counters_reset();
+      start = microtime();
+      kawasaki_metropolis(lattice, L, T, STEPS / (L * L), num_threads[i]);
+      end = microtime();
+      time = end - start;
+      printf("Thread count: %d\n",num_threads[i]);
+      printf("Run Time: %f\n", time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      printf("Magnetization: %ld\n", lattice_magnetization(lattice, L));
+      counters_print(stdout);
+    }
+    initialize_lattice(lattice,L);
+
+    //q-state Potts; q = 2 runs the int +-1 Ising kernel (at half the coupling), larger q one byte per site
+    printf("Potts\n");
+    for(int q = POTTS_MIN_Q; q <= POTTS_MAX_Q; q++){
+      potts_lattice_t potts;
+      if(potts_lattice_init(&potts, L, q) != 0) return 1;
+      counters_reset();
+      start = microtime();
+      potts_metropolis(&potts, T, STEPS);
+      end = microtime();
+      time = end - start;
+      printf("q: %d\n", q);
+      printf("Serial Run Time: %f\n", time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      counters_print(stdout);
+
+      counters_reset();
+      start = microtime();
+      potts_checkerboard(&potts, T, STEPS / (L * L), num_threads[3]);
+      end = microtime();
+      time = end - start;
+      printf("Checkerboard Run Time (%d threads): %f\n", num_threads[3], time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      printf("Energy per site: %f\n", (double)potts_energy(&potts) / (L * L));
+      counters_print(stdout);
+      potts_lattice_free(&potts);
+    }
+
+    //hybrid: probes checkerboard, Wolff and n-fold on-line and keeps whichever gives the cheapest independent sample
+    printf("Hybrid\n");
+    for(int i = 0; i < 4; i++){
+      hybrid_stats_t stats;
+      counters_reset();
+      start = microtime();
+      hybrid_metropolis(lattice, L, T, STEPS, num_threads[i], &stats);
+      end = microtime();
+      time = end - start;
+      printf("Thread count: %d\n",num_threads[i]);
+      printf("Run Time: %f\n", time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      for(int u = 0; u < HYBRID_COUNT; u++){
+        printf("  %s: %ld sweeps, tau %f, cost %f us\n", hybrid_update_name(u), stats.sweeps[u], stats.tau[u], stats.cost[u]);
+      }
+      printf("Choice: %s\n", hybrid_update_name(stats.last));
+      counters_print(stdout);
+      initialize_lattice(lattice,L);
+    }
+
     //parallelism without locks
     //we expect this to perform poorly due to false sharing and cache locality and race condition of no locks. when threads access same line it will false share
     printf("Naive Parallelism\n");
     
     for(int i = 0; i < 4; i++){
+      counters_reset();
       start = microtime();
       naive_metropolis(lattice,L,T,STEPS,num_threads[i]);
       end = microtime();
       time = end - start;
       printf("Thread count: %d\n",num_threads[i]);
       printf("Run Time: %f\n", time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      counters_print(stdout);
       //print_lattice(lattice,L);
       if(i==3)print_lattice(lattice,L);
       initialize_lattice(lattice,L);
@@ -75,6 +366,7 @@ int main() {
     //this may also perform poorly due to overhead of all the locks
     printf("Task Parallelism Test\n");
     for(int i = 0; i < 4; i++){
+      counters_reset();
       start = microtime();
       ising_openmp_taskparallel(lattice, L, T, STEPS, num_threads[i]);
       end = microtime();
@@ -82,6 +374,8 @@ int main() {
 
       printf("Thread count: %d\n", num_threads[i]);
       printf("Run Time: %f\n", time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      counters_print(stdout);
       //print_lattice(lattice,L);
       if(i==3)print_lattice(lattice,L);
       initialize_lattice(lattice,L);
@@ -92,12 +386,15 @@ int main() {
 
     //openmp mulithread; data parallelism to minimize collision and locking of threads
     for(int i = 0; i < 4; i++){
+      counters_reset();
       start = microtime();
       ising_openmp_dataparallel(lattice,L,T,STEPS,num_threads[i]);
       end = microtime();
       time = end - start;
       printf("Thread count: %d\n", num_threads[i]);
       printf("Run Time: %f\n", time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      counters_print(stdout);
       //print_lattice(lattice,L);
       if(i==3)print_lattice(lattice,L);
       initialize_lattice(lattice,L);
@@ -106,13 +403,17 @@ int main() {
     
     printf("Begin Data+\n");
     //openmp multithread; dataparallelism without locks; maintains an array to make sure boundaries arent't colliding
+    //every thread runs the steps it is given, so split STEPS between them to keep the work equal to the other engines
     for(int i = 0; i < 4; i++){
+      counters_reset();
       start = microtime();
-      ising_openmp_signalparallel(lattice,L,T,STEPS,num_threads[i]);
+      ising_openmp_signalparallel(lattice,L,T,STEPS/num_threads[i],num_threads[i]);
       end = microtime();
       time = end - start;
       printf("Thread count: %d\n",num_threads[i]);
       printf("Run Time: %f\n",time);
+      printf("Sweeps/sec: %f\n", sweeps_per_second(L, STEPS, time));
+      counters_print(stdout);
       //print_lattice(lattice,L);
       if(i==3)print_lattice(lattice,L);
       initialize_lattice(lattice,L);
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include "microtime.h"
+#include "ising_model.h"
+#include "ising_hybrid.h"
+#include "ising_sweep.h"
+#include "ising_temporal.h"
+#include "ising_nfold.h"
+#include "ising_rng.h"
+#include "ising_counters.h"
+
+//samples taken while probing one update type, and how many probe lengths the winner then runs before the next probe
+#define HYBRID_PROBE_SAMPLES 64
+#define HYBRID_EXPLOIT_FACTOR 8
+//n-fold copies the lattice in and out per call, so it is sampled every few sweeps instead of every sweep
+#define HYBRID_NFOLD_SWEEPS 8
+//rejection-free updates only pay off once most checkerboard proposals are rejected
+#define HYBRID_NFOLD_MAX_ACCEPTANCE 0.25
+//a short window cannot see correlations much longer than itself: lag-1 estimates past this many samples are
+//treated as unresolved and the probe is repeated with samples twice as far apart, up to the widest spacing
+#define HYBRID_RESOLVED_TAU 4.0
+#define HYBRID_MAX_SPACING 32
+
+static const char *update_names[HYBRID_COUNT] = {
+  [HYBRID_CHECKERBOARD] = "checkerboard",
+  [HYBRID_WOLFF]        = "wolff",
+  [HYBRID_NFOLD]        = "nfold",
+};
+
+const char *hybrid_update_name(hybrid_update_t update){
+  return update_names[update];
+}
+
+//grow and flip one Wolff cluster from a random seed; spins are flipped as they join, so the lattice itself marks
+//visited sites and every site is pushed at most once. returns the cluster size
+static long wolff_cluster(int **lattice, int L, double p_add, int *stack, rng_stream_t *rng){
+  int seed = rng_bounded(rng, L * L);
+  int s = lattice[seed / L][seed % L];
+  lattice[seed / L][seed % L] = -s;
+  int top = 0;
+  stack[top++] = seed;
+  long size = 1;
+
+  while(top > 0){
+    int site = stack[--top];
+    int x = site / L, y = site % L;
+    int neighbors[4] = {((x + 1) % L) * L + y, ((x - 1 + L) % L) * L + y, x * L + (y + 1) % L, x * L + (y - 1 + L) % L};
+    for(int k = 0; k < 4; k++){
+      int nx = neighbors[k] / L, ny = neighbors[k] % L;
+      if(lattice[nx][ny] == s && rng_uniform(rng) < p_add){
+        lattice[nx][ny] = -s;
+        stack[top++] = neighbors[k];
+        size++;
+      }
+    }
+  }
+  COUNT_ADD(COUNTER_ACCEPTS, size);
+  return size;
+}
+
+//clusters until at least 'sites' spins have been flipped
+static long wolff_run(int **lattice, int L, double T, long sites, int *stack, rng_stream_t *rng){
+  double p_add = 1.0 - exp(-2.0 / T);
+  long flipped = 0;
+  while(flipped < sites){
+    flipped += wolff_cluster(lattice, L, p_add, stack, rng);
+  }
+  return flipped;
+}
+
+//Wolff single-cluster updates, p_add = 1 - exp(-2/T). 'steps' counts flipped spins, so steps = L*L is one sweep
+//equivalent. returns the number of clusters
+long wolff_metropolis(int **lattice, int L, double T, int steps){
+  int *stack = (int *)malloc((size_t)L * L * sizeof(int));
+  if(stack == NULL) return 0;
+  double p_add = 1.0 - exp(-2.0 / T);
+  rng_stream_t *rng = rng_thread();
+  long flipped = 0, clusters = 0;
+  while(flipped < steps){
+    flipped += wolff_cluster(lattice, L, p_add, stack, rng);
+    clusters++;
+  }
+  free(stack);
+  return clusters;
+}
+
+//run 'sweeps' sweep equivalents of one update type. returns accepted flips for checkerboard, 0 otherwise
+static long run_update(hybrid_update_t update, int **lattice, int L, double T, long sweeps, int num_threads, int *stack){
+  long N = (long)L * L;
+  switch(update){
+    case HYBRID_CHECKERBOARD:
+      return checkerboard_metropolis(lattice, L, T, sweeps, num_threads);
+    case HYBRID_WOLFF:
+      wolff_run(lattice, L, T, sweeps * N, stack, rng_thread());
+      return 0;
+    case HYBRID_NFOLD:
+      //steps is an int, so long runs go in chunks
+      while(sweeps > 0){
+        long chunk = (sweeps * N > INT_MAX) ? INT_MAX / N : sweeps;
+        nfold_metropolis(lattice, L, T, chunk * N);
+        sweeps -= chunk;
+      }
+      return 0;
+    default:
+      return 0;
+  }
+}
+
+static int sweeps_per_sample(hybrid_update_t update){
+  return (update == HYBRID_NFOLD) ? HYBRID_NFOLD_SWEEPS : 1;
+}
+
+//integrated autocorrelation time in samples from the lag-1 autocorrelation, assuming exponential decay:
+//tau = (1 + rho) / (2 (1 - rho)). a series that never moves counts as uncorrelated
+static double lag1_tau(const double *series, int n){
+  double mean = 0;
+  for(int i = 0; i < n; i++){
+    mean += series[i];
+  }
+  mean /= n;
+  double var = 0, cov = 0;
+  for(int i = 0; i < n; i++){
+    var += (series[i] - mean) * (series[i] - mean);
+    if(i > 0) cov += (series[i] - mean) * (series[i - 1] - mean);
+  }
+  if(var <= 0) return 0.5;
+  double rho = cov / var;
+  if(rho < 0) rho = 0;
+  if(rho > 0.999) rho = 0.999;
+  return 0.5 * (1 + rho) / (1 - rho);
+}
+
+//run one probe of an update type, sampling energy and |m| every per_sample sweep equivalents. only engine time is
+//counted. returns the cost per independent sample in us, tau in samples, and the acceptance for checkerboard
+static double probe(hybrid_update_t update, int **lattice, int L, double T, int num_threads, int per_sample, int *stack,
+                    double *m_series, double *e_series, double *tau_samples, double *acceptance){
+  long N = (long)L * L;
+  double elapsed = 0;
+  long accepted = 0;
+
+  for(int i = 0; i < HYBRID_PROBE_SAMPLES; i++){
+    double start = microtime();
+    accepted += run_update(update, lattice, L, T, per_sample, num_threads, stack);
+    elapsed += microtime() - start;
+    m_series[i] = fabs((double)lattice_magnetization(lattice, L)) / N;
+    e_series[i] = (double)lattice_energy(lattice, L) / N;
+  }
+
+  double tau = fmax(lag1_tau(m_series, HYBRID_PROBE_SAMPLES), lag1_tau(e_series, HYBRID_PROBE_SAMPLES));
+  *tau_samples = tau;
+  if(update == HYBRID_CHECKERBOARD) *acceptance = (double)accepted / ((double)HYBRID_PROBE_SAMPLES * per_sample * N);
+  return elapsed / HYBRID_PROBE_SAMPLES * 2 * tau;
+}
+
+//last choice, reused by calls too short to probe (e.g. one sweep at a time from the equilibration driver)
+static __thread int last_L = -1;
+static __thread double last_T;
+static __thread hybrid_update_t last_choice = HYBRID_CHECKERBOARD;
+
+//adaptive engine: probes checkerboard Metropolis, Wolff clusters and n-fold way in turn, estimates each one's
+//autocorrelation time from its own samples, and runs the one with the lowest cost per independent sample for a
+//while before probing again. n-fold is skipped unless the checkerboard acceptance is low. probes are real updates,
+//so they count towards 'steps' (single-site updates, rounded down to whole sweeps). stats may be NULL
+void hybrid_metropolis(int **lattice, int L, double T, int steps, int num_threads, hybrid_stats_t *stats){
+  long N = (long)L * L;
+  hybrid_stats_t local;
+  if(stats == NULL) stats = &local;
+  memset(stats, 0, sizeof(*stats));
+  stats->acceptance = 1;
+
+  long remaining = steps / N;
+  if(remaining == 0){
+    ordered_metropolis(lattice, L, T, steps, 0);
+    return;
+  }
+
+  int *stack = (int *)malloc(N * sizeof(int));
+  double *m_series = (double *)malloc(HYBRID_PROBE_SAMPLES * sizeof(double));
+  double *e_series = (double *)malloc(HYBRID_PROBE_SAMPLES * sizeof(double));
+  if(stack == NULL || m_series == NULL || e_series == NULL){
+    fprintf(stderr, "hybrid_metropolis: allocation failed, running checkerboard\n");
+    checkerboard_metropolis(lattice, L, T, remaining, num_threads);
+    free(stack);
+    free(m_series);
+    free(e_series);
+    return;
+  }
+
+  hybrid_update_t best = (last_L == L && last_T == T) ? last_choice : HYBRID_CHECKERBOARD;
+  int spacing[HYBRID_COUNT];
+  for(int u = 0; u < HYBRID_COUNT; u++){
+    spacing[u] = sweeps_per_sample(u);
+  }
+  while(remaining > 0){
+    double best_cost = INFINITY;
+    hybrid_update_t probe_best = best;
+    int probed = 0;
+    //checkerboard goes first so its acceptance is known before n-fold is considered
+    for(int u = 0; u < HYBRID_COUNT; u++){
+      if(u == HYBRID_NFOLD && stats->acceptance > HYBRID_NFOLD_MAX_ACCEPTANCE) continue;
+      spacing[u] = sweeps_per_sample(u);
+      double cost = -1, tau;
+      for(;;){
+        long length = (long)HYBRID_PROBE_SAMPLES * spacing[u];
+        if(length > remaining) break;
+        cost = probe(u, lattice, L, T, num_threads, spacing[u], stack, m_series, e_series, &tau, &stats->acceptance);
+        remaining -= length;
+        stats->sweeps[u] += length;
+        if(tau <= HYBRID_RESOLVED_TAU || spacing[u] * 2 > HYBRID_MAX_SPACING) break;
+        spacing[u] *= 2;
+      }
+      if(cost < 0) continue;
+
+      stats->tau[u] = tau * spacing[u];
+      stats->cost[u] = cost;
+      probed++;
+      if(cost < best_cost){
+        best_cost = cost;
+        probe_best = u;
+      }
+    }
+    //a single probe has nothing to compare against; keep the previous choice
+    if(probed > 1){
+      best = probe_best;
+      stats->choices++;
+      last_L = L;
+      last_T = T;
+      last_choice = best;
+    }
+
+    long epoch = (long)HYBRID_EXPLOIT_FACTOR * HYBRID_PROBE_SAMPLES * spacing[best];
+    if(epoch > remaining || probed <= 1) epoch = remaining;
+    run_update(best, lattice, L, T, epoch, num_threads, stack);
+    remaining -= epoch;
+    stats->sweeps[best] += epoch;
+  }
+  stats->last = best;
+
+  free(stack);
+  free(m_series);
+  free(e_series);
+}
@@ -0,0 +1,26 @@
+#ifndef ISING_HYBRID_H
+#define ISING_HYBRID_H
+
+//update types the hybrid engine chooses between
+typedef enum {
+  HYBRID_CHECKERBOARD,
+  HYBRID_WOLFF,
+  HYBRID_NFOLD,
+  HYBRID_COUNT
+} hybrid_update_t;
+
+//what the hybrid engine measured and picked during one call
+typedef struct {
+  long sweeps[HYBRID_COUNT];         //sweep equivalents run with each update type
+  double tau[HYBRID_COUNT];          //last autocorrelation time estimate, in sweep equivalents (0 if never probed)
+  double cost[HYBRID_COUNT];         //last cost per independent sample, us (0 if never probed)
+  double acceptance;                 //last checkerboard acceptance rate
+  int choices;                       //times the choice was (re)made
+  hybrid_update_t last;
+} hybrid_stats_t;
+
+long wolff_metropolis(int **lattice, int L, double T, int steps);
+void hybrid_metropolis(int **lattice, int L, double T, int steps, int num_threads, hybrid_stats_t *stats);
+const char *hybrid_update_name(hybrid_update_t update);
+
+#endif
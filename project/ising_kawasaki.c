@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <omp.h>
+#include "ising_model.h"
+#include "ising_kawasaki.h"
+#include "ising_rng.h"
+#include "ising_counters.h"
+
+//bonds are split into 16 colors: horizontal bonds (x,y)-(x,y+1) by (x%2, y%4) and vertical bonds (x,y)-(x+1,y)
+//by (x%4, y%2). two bonds of one color are at least two rows (or four columns) apart, so neither writes a site
+//the other reads, and a whole color can be updated in parallel without locks
+#define KAWASAKI_COLORS 16
+
+//heat-bath exchange of the spins on bond a-b. with full neighbor sums n_a and n_b (each including the other end),
+//swapping opposite spins costs deltaE = 2 s_a n_a + 2 s_b n_b - 4 s_a s_b, one of -12, -8, .., 12
+static inline int exchange(int **lattice, int L, int ax, int ay, int bx, int by, const double *table, rng_stream_t *rng){
+  int s_a = lattice[ax][ay];
+  int s_b = lattice[bx][by];
+  COUNT(COUNTER_ATTEMPTS);
+  if(s_a == s_b) return 0;
+
+  int n_a = lattice[(ax + 1) % L][ay] + lattice[(ax - 1 + L) % L][ay] + lattice[ax][(ay + 1) % L] + lattice[ax][(ay - 1 + L) % L];
+  int n_b = lattice[(bx + 1) % L][by] + lattice[(bx - 1 + L) % L][by] + lattice[bx][(by + 1) % L] + lattice[bx][(by - 1 + L) % L];
+  int deltaE = 2 * s_a * n_a + 2 * s_b * n_b - 4 * s_a * s_b;
+  if(rng_uniform(rng) < table[(deltaE + 12) >> 2]){
+    lattice[ax][ay] = s_b;
+    lattice[bx][by] = s_a;
+    COUNT(COUNTER_ACCEPTS);
+    return 1;
+  }
+  return 0;
+}
+
+//Kawasaki spin-exchange dynamics: magnetization is conserved, so start from initialize_lattice_fixed.
+//every sweep proposes each of the 2N nearest-neighbor bonds once, one color at a time in a freshly shuffled order.
+//L must be a multiple of 4. returns the number of accepted exchanges, or -1 if L does not fit the coloring
+long kawasaki_metropolis(int **lattice, int L, double T, int sweeps, int num_threads){
+  if(L % 4 != 0){
+    fprintf(stderr, "kawasaki_metropolis: L = %d is not a multiple of 4\n", L);
+    return -1;
+  }
+  double table[7];
+  for(int i = 0; i < 7; i++){
+    table[i] = flip_probability(4 * i - 12, T);
+  }
+  int order[KAWASAKI_COLORS];
+  for(int c = 0; c < KAWASAKI_COLORS; c++){
+    order[c] = c;
+  }
+  long accepted = 0;
+
+  #pragma omp parallel num_threads(num_threads) reduction(+:accepted)
+  {
+    rng_stream_t *rng = rng_thread();
+    for(int s = 0; s < sweeps; s++){
+      #pragma omp single
+      {
+        for(int c = KAWASAKI_COLORS - 1; c > 0; c--){
+          int k = rng_bounded(rng, c + 1);
+          int t = order[c];
+          order[c] = order[k];
+          order[k] = t;
+        }
+      }
+
+      for(int c = 0; c < KAWASAKI_COLORS; c++){
+        int color = order[c];
+        int vertical = color >> 3;
+        //offsets of the bond's first site: (x%2, y%4) for horizontal, (x%4, y%2) for vertical
+        int x0 = vertical ? (color & 3) : (color & 1);
+        int y0 = vertical ? ((color >> 2) & 1) : ((color >> 1) & 3);
+        int x_step = vertical ? 4 : 2;
+        int y_step = vertical ? 2 : 4;
+
+        #pragma omp for schedule(static)
+        for(int x = x0; x < L; x += x_step){
+          for(int y = y0; y < L; y += y_step){
+            if(vertical){
+              accepted += exchange(lattice, L, x, y, (x + 1) % L, y, table, rng);
+            }else{
+              accepted += exchange(lattice, L, x, y, x, (y + 1) % L, table, rng);
+            }
+          }
+        }
+      }
+    }
+  }
+  return accepted;
+}
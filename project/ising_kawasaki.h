@@ -0,0 +1,5 @@
+#ifndef ISING_KAWASAKI_H
+#define ISING_KAWASAKI_H
+
+long kawasaki_metropolis(int **lattice, int L, double T, int sweeps, int num_threads);
+#endif
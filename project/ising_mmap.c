@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "ising_mmap.h"
+#include "ising_model.h"
+#include "ising_rng.h"
+#include "ising_counters.h"
+
+static const char MMAP_MAGIC[8] = {'I','S','I','N','G','B','P','1'};
+
+static inline uint64_t *row_ptr(mmap_lattice_t *lat, long x){
+  return lat->spins + (size_t)x * lat->words_per_row;
+}
+
+//spin at column y of a packed row as +1/-1
+static inline int get_spin(const uint64_t *row, long y){
+  return ((row[y >> 6] >> (y & 63)) & 1) ? 1 : -1;
+}
+
+//madvise on rows [first, last) of the lattice. WILLNEED rounds outward so the whole band is read ahead;
+//DONTNEED rounds inward so pages shared with a neighboring band stay mapped
+static void advise_rows(mmap_lattice_t *lat, long first, long last, int advice){
+  if(first < 0) first = 0;
+  if(last > lat->L) last = lat->L;
+  if(first >= last) return;
+
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t row_bytes = lat->words_per_row * sizeof(uint64_t);
+  size_t start = lat->data_offset + first * row_bytes;
+  size_t end = lat->data_offset + last * row_bytes;
+  if(advice == MADV_DONTNEED){
+    start = (start + page - 1) / page * page;
+    end = end / page * page;
+  }else{
+    start = start / page * page;
+    end = (end + page - 1) / page * page;
+  }
+  if(end > lat->map_size) end = lat->map_size;
+  if(start >= end) return;
+
+  if(advice == MADV_DONTNEED){
+    //start writeback of the band before dropping it from our mapping; the data stays in the page cache
+    msync(lat->map + start, end - start, MS_ASYNC);
+  }
+  madvise(lat->map + start, end - start, advice);
+}
+
+static int map_file(mmap_lattice_t *lat){
+  lat->map = mmap(NULL, lat->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, lat->fd, 0);
+  if(lat->map == MAP_FAILED){
+    perror("mmap");
+    close(lat->fd);
+    return -1;
+  }
+  madvise(lat->map, lat->map_size, MADV_SEQUENTIAL);
+  lat->spins = (uint64_t *)(lat->map + lat->data_offset);
+  return 0;
+}
+
+//create an LxL lattice file with random spins, written band by band so it never has to fit in memory.
+//returns 0 on success, -1 on failure
+int mmap_lattice_create(mmap_lattice_t *lat, const char *path, long L, long band_rows){
+  if(L < 2){
+    fprintf(stderr, "Lattice size must be at least 2\n");
+    return -1;
+  }
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  lat->L = L;
+  lat->words_per_row = (L + 63) / 64;
+  lat->data_offset = (sizeof(mmap_lattice_header_t) + page - 1) / page * page;
+  lat->map_size = lat->data_offset + (size_t)L * lat->words_per_row * sizeof(uint64_t);
+
+  lat->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(lat->fd < 0){
+    perror(path);
+    return -1;
+  }
+  if(ftruncate(lat->fd, lat->map_size) != 0){
+    perror("ftruncate");
+    close(lat->fd);
+    return -1;
+  }
+  if(map_file(lat) != 0) return -1;
+
+  mmap_lattice_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MMAP_MAGIC, sizeof(MMAP_MAGIC));
+  header.L = L;
+  header.words_per_row = lat->words_per_row;
+  header.data_offset = lat->data_offset;
+  memcpy(lat->map, &header, sizeof(header));
+
+  //bits past column L-1 in the last word of each row are kept zero
+  uint64_t tail_mask = (L % 64) ? ((1ULL << (L % 64)) - 1) : ~0ULL;
+  rng_stream_t *rng = rng_thread();
+  if(band_rows <= 0) band_rows = L;
+  for(long start = 0; start < L; start += band_rows){
+    long end = (start + band_rows < L) ? start + band_rows : L;
+    for(long x = start; x < end; x++){
+      uint64_t *row = row_ptr(lat, x);
+      for(long w = 0; w < lat->words_per_row; w++){
+        row[w] = ((uint64_t)rng_next(rng) << 32) | rng_next(rng);
+      }
+      row[lat->words_per_row - 1] &= tail_mask;
+    }
+    advise_rows(lat, start, end, MADV_DONTNEED);
+  }
+  return 0;
+}
+
+//open an existing lattice file. returns 0 on success, -1 on failure
+int mmap_lattice_open(mmap_lattice_t *lat, const char *path){
+  lat->fd = open(path, O_RDWR);
+  if(lat->fd < 0){
+    perror(path);
+    return -1;
+  }
+  mmap_lattice_header_t header;
+  if(pread(lat->fd, &header, sizeof(header), 0) != sizeof(header) || memcmp(header.magic, MMAP_MAGIC, sizeof(MMAP_MAGIC)) != 0){
+    fprintf(stderr, "%s is not a lattice file\n", path);
+    close(lat->fd);
+    return -1;
+  }
+  //only accept the layout mmap_lattice_create writes: whole 64 bit words per row, and rows starting on the
+  //page after the header
+  long page = sysconf(_SC_PAGESIZE);
+  if(header.L < 2 || header.words_per_row != header.L / 64 + (header.L % 64 != 0) ||
+     header.data_offset < (int64_t)sizeof(header) || header.data_offset % page != 0){
+    fprintf(stderr, "%s is not a lattice file\n", path);
+    close(lat->fd);
+    return -1;
+  }
+  //compare by division so a huge L cannot wrap the data size past the check
+  off_t file_size = lseek(lat->fd, 0, SEEK_END);
+  size_t row_bytes = (size_t)header.words_per_row * sizeof(uint64_t);
+  if(file_size < 0 || (uint64_t)file_size < (uint64_t)header.data_offset ||
+     (uint64_t)header.L > ((uint64_t)file_size - header.data_offset) / row_bytes){
+    fprintf(stderr, "%s is truncated\n", path);
+    close(lat->fd);
+    return -1;
+  }
+  lat->L = header.L;
+  lat->words_per_row = header.words_per_row;
+  lat->data_offset = header.data_offset;
+  lat->map_size = lat->data_offset + (size_t)lat->L * row_bytes;
+  return map_file(lat);
+}
+
+void mmap_lattice_close(mmap_lattice_t *lat){
+  if(lat->map != NULL && lat->map != MAP_FAILED){
+    msync(lat->map, lat->map_size, MS_SYNC);
+    munmap(lat->map, lat->map_size);
+  }
+  close(lat->fd);
+  lat->map = NULL;
+  lat->spins = NULL;
+}
+
+//typewriter update of one packed row given the rows above and below it
+static void update_row(uint64_t *row, const uint64_t *up, const uint64_t *down, long L, const double *table, rng_stream_t *rng){
+  for(long y = 0; y < L; y++){
+    long left = (y == 0) ? L - 1 : y - 1;
+    long right = (y == L - 1) ? 0 : y + 1;
+    int sum_neighbors = get_spin(up, y) + get_spin(down, y) + get_spin(row, left) + get_spin(row, right);
+    int deltaE = 2 * get_spin(row, y) * sum_neighbors;
+    COUNT(COUNTER_ATTEMPTS);
+    if(rng_uniform(rng) < table[(deltaE + 8) >> 2]){
+      row[y >> 6] ^= 1ULL << (y & 63);
+      COUNT(COUNTER_ACCEPTS);
+    }
+  }
+}
+
+//streaming typewriter sweeps over the file in bands of band_rows rows. while a band is updated the next one is
+//read ahead with MADV_WILLNEED, and the band before it is released once nothing reads it any more.
+//the periodic boundary rows are kept in two row buffers so the far end of the file is never faulted back in:
+//row 0 sees the last row as it was before this sweep, and the last row sees row 0 as already updated,
+//exactly as an in-memory typewriter sweep would
+void mmap_ordered_metropolis(mmap_lattice_t *lat, double T, long sweeps, long band_rows){
+  long L = lat->L;
+  size_t row_bytes = lat->words_per_row * sizeof(uint64_t);
+  uint64_t *halo_up = (uint64_t *)malloc(row_bytes);
+  uint64_t *halo_down = (uint64_t *)malloc(row_bytes);
+  rng_stream_t *rng = rng_thread();
+
+  //same acceptance rule as metropolis()
+  double table[5];
+  flip_table(T, table);
+
+  if(band_rows <= 0 || band_rows > L) band_rows = L;
+
+  for(long s = 0; s < sweeps; s++){
+    memcpy(halo_up, row_ptr(lat, L - 1), row_bytes);
+
+    for(long start = 0; start < L; start += band_rows){
+      long end = (start + band_rows < L) ? start + band_rows : L;
+      advise_rows(lat, end, end + band_rows, MADV_WILLNEED);
+
+      for(long x = start; x < end; x++){
+        const uint64_t *up = (x == 0) ? halo_up : row_ptr(lat, x - 1);
+        const uint64_t *down = (x == L - 1) ? halo_down : row_ptr(lat, x + 1);
+        update_row(row_ptr(lat, x), up, down, L, table, rng);
+        if(x == 0){
+          memcpy(halo_down, row_ptr(lat, 0), row_bytes);
+        }
+      }
+
+      //the first row of this band was the last reader of the previous band
+      if(start > 0){
+        advise_rows(lat, start - band_rows, start, MADV_DONTNEED);
+      }
+    }
+    advise_rows(lat, (L - 1) / band_rows * band_rows, L, MADV_DONTNEED);
+  }
+
+  free(halo_up);
+  free(halo_down);
+}
+
+//mean spin, streamed band by band like the sweeps
+double mmap_lattice_magnetization(mmap_lattice_t *lat, long band_rows){
+  long L = lat->L;
+  long up_spins = 0;
+  if(band_rows <= 0 || band_rows > L) band_rows = L;
+
+  for(long start = 0; start < L; start += band_rows){
+    long end = (start + band_rows < L) ? start + band_rows : L;
+    advise_rows(lat, end, end + band_rows, MADV_WILLNEED);
+    for(long x = start; x < end; x++){
+      const uint64_t *row = row_ptr(lat, x);
+      for(long w = 0; w < lat->words_per_row; w++){
+        up_spins += __builtin_popcountll(row[w]);
+      }
+    }
+    advise_rows(lat, start, end, MADV_DONTNEED);
+  }
+  return (2.0 * up_spins - (double)L * L) / ((double)L * L);
+}
@@ -0,0 +1,32 @@
+#ifndef ISING_MMAP_H
+#define ISING_MMAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//on-disk header. spins follow at data_offset (page aligned), one bit per spin (1 = up), rows padded to whole 64 bit words
+typedef struct {
+  char magic[8];
+  int64_t L;
+  int64_t words_per_row;
+  int64_t data_offset;
+} mmap_lattice_header_t;
+
+//a lattice living in a memory-mapped file, for L too large to hold as int**
+typedef struct {
+  int fd;
+  long L;
+  long words_per_row;
+  size_t data_offset;
+  size_t map_size;
+  unsigned char *map;
+  uint64_t *spins;
+} mmap_lattice_t;
+
+int mmap_lattice_create(mmap_lattice_t *lat, const char *path, long L, long band_rows);
+int mmap_lattice_open(mmap_lattice_t *lat, const char *path);
+void mmap_lattice_close(mmap_lattice_t *lat);
+void mmap_ordered_metropolis(mmap_lattice_t *lat, double T, long sweeps, long band_rows);
+double mmap_lattice_magnetization(mmap_lattice_t *lat, long band_rows);
+
+#endif
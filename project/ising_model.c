@@ -4,6 +4,9 @@
 #include <omp.h>
 #include "microtime.h"
 #include "ising_model.h"
+#include "ising_rng.h"
+#include "ising_counters.h"
+#include "ising_trace.h"
 
 // Function to initialize the lattice with random spins
 void initialize_lattice(int **lattice, int L) {
@@ -14,6 +17,21 @@ void initialize_lattice(int **lattice, int L) {
     }
 }
 
+// Random initialization with exactly 'up' spins up (N - up down), for dynamics that conserve magnetization
+void initialize_lattice_fixed(int **lattice, int L, long up) {
+    long N = (long)L * L;
+    long remaining = N;
+    // selection sampling: each site is up with probability (ups left)/(sites left)
+    for (int i = 0; i < L; i++) {
+        for (int j = 0; j < L; j++) {
+            int is_up = random_double() * remaining < up;
+            lattice[i][j] = is_up ? 1 : -1;
+            up -= is_up;
+            remaining--;
+        }
+    }
+}
+
 // Function to print the lattice configuration
 void print_lattice(int **lattice, int L) {
     for (int i = 0; i < L; i++) {
@@ -29,16 +47,30 @@ void print_lattice(int **lattice, int L) {
 }
 
 // Function to generate a random integer between min and max (inclusive)
-//NOT thread safe
+//Thread safe; draws from the calling thread's buffered stream
 int random_int(int min, int max) {
-    return min + rand() % (max - min + 1);
+    return min + (int)rng_bounded(rng_thread(), max - min + 1);
 }
 
 // Function to generate a random double between 0.0 and 1.0
-//Thread safe
+//Thread safe; draws from the calling thread's buffered stream
 double random_double() {
-    unsigned int seed = 42 + omp_get_thread_num(); // Unique seed for each thread (can also use time or thread_id)
-    return (double)rand_r(&seed) / RAND_MAX;
+    return rng_uniform(rng_thread());
+}
+
+//heat-bath probability of flipping a spin whose flip costs deltaE.
+//partition has two terms in the sum: the flipped state (energy deltaE) and the current state (energy 0),
+//so the chain samples exp(-E/T) exactly. histogram reweighting depends on that
+double flip_probability(int deltaE, double T){
+    return exp(-deltaE/T)/(exp(-deltaE/T) + 1.0);
+}
+
+//flip_probability for each of the five possible deltaE values (-8,-4,0,4,8), indexed by (deltaE+8)/4,
+//for kernels that look it up instead of calling exp() per update
+void flip_table(double T, double *table){
+  for(int k = 0; k < 5; k++){
+    table[k] = flip_probability(4 * k - 8, T);
+  }
 }
 
 // Metropolis algorithm for the Ising model update
@@ -55,35 +87,72 @@ void metropolis(int **lattice, int L, double T, int x, int y) {
     //accept flip with probability scaled by T, E
     double threshold = random_double();
 
-    //partition has two terms in the sum
-    double partition = exp(-deltaE/T) + exp(deltaE/T);
-    double probabilityOfFlip = exp(-deltaE/T)/partition;
+    double probabilityOfFlip = flip_probability(deltaE, T);
+    COUNT(COUNTER_ATTEMPTS);
     if (threshold < probabilityOfFlip) {  // T is temperature parameter. Boltzmann constant assumed to be 1
         lattice[x][y] = -lattice[x][y]; // Flip the spin
+        COUNT(COUNTER_ACCEPTS);
     }
 }
 
 //serial update; control condition for comparison
+//site coordinates are drawn in bulk, one buffer's worth at a time
 void serial_metropolis(int **lattice, int L, double T, int steps){
-  
-  for(int i = 0; i < steps; i++){
-    int x = random_int(0,(L-1));
-    int y = random_int(0,(L-1));
-    metropolis(lattice,L,T,x,y);
+  rng_stream_t *rng = rng_thread();
+  int xs[RNG_BUFFER_SIZE], ys[RNG_BUFFER_SIZE];
+
+  for(int i = 0; i < steps; i += RNG_BUFFER_SIZE){
+    int chunk = (steps - i < RNG_BUFFER_SIZE) ? steps - i : RNG_BUFFER_SIZE;
+    rng_fill_bounded(rng, xs, chunk, L);
+    rng_fill_bounded(rng, ys, chunk, L);
+    for(int k = 0; k < chunk; k++){
+      metropolis(lattice,L,T,xs[k],ys[k]);
+    }
   }
 }
 
+#ifdef ISING_COUNTERS
+//race accounting for naive_metropolis: mark the site being updated, and count an update whose neighbors are
+//marked by another thread at the same time. only built with counters since the marks cost two atomics per update
+static int naive_neighbor_busy(int *updating, int L, int x, int y){
+  int busy[4];
+  #pragma omp atomic read
+  busy[0] = updating[((x + 1) % L) * L + y];
+  #pragma omp atomic read
+  busy[1] = updating[((x - 1 + L) % L) * L + y];
+  #pragma omp atomic read
+  busy[2] = updating[x * L + (y + 1) % L];
+  #pragma omp atomic read
+  busy[3] = updating[x * L + (y - 1 + L) % L];
+  return busy[0] || busy[1] || busy[2] || busy[3];
+}
+#endif
+
 //we expect this to cause false sharing and cache misses as threads may hit same row
 void naive_metropolis(int **lattice, int L, double T, int steps, int num_threads){
   int x,y;
-  unsigned int seed;
-  #pragma omp parallel for private(x,y,seed) shared(lattice) schedule(static) num_threads(num_threads)
+#ifdef ISING_COUNTERS
+  int *updating = (int *)calloc((size_t)L * L, sizeof(int));
+#endif
+  #pragma omp parallel for private(x,y) shared(lattice) schedule(static) num_threads(num_threads)
   for(int i = 0; i < steps; i++){
-    seed = i + omp_get_thread_num();
-    x = rand_r(&seed) % L;
-    y = rand_r(&seed) % L;
+    rng_stream_t *rng = rng_thread();
+    x = rng_bounded(rng, L);
+    y = rng_bounded(rng, L);
+#ifdef ISING_COUNTERS
+    #pragma omp atomic update
+    updating[x * L + y]++;
+    if(naive_neighbor_busy(updating, L, x, y)) COUNT(COUNTER_NAIVE_RACES);
+#endif
     metropolis(lattice,L,T,x,y);
+#ifdef ISING_COUNTERS
+    #pragma omp atomic update
+    updating[x * L + y]--;
+#endif
   }
+#ifdef ISING_COUNTERS
+  free(updating);
+#endif
 }
 
 //acquire locks on lattice site and all neighbors
@@ -115,6 +184,7 @@ int getLocks(omp_lock_t **locks, int L, int x, int y){
 
     // If not all locks were acquired, release any acquired locks and return 0
     if (!lock_acquired){
+      if (locks_acquired[0] || locks_acquired[1] || locks_acquired[2] || locks_acquired[3] || locks_acquired[4]) COUNT(COUNTER_LOCK_BACKOFFS);
       if (locks_acquired[0]) omp_unset_lock(&locks[x][y]);
       if (locks_acquired[1]) omp_unset_lock(&locks[(x - 1 + L) % L][y]);
       if (locks_acquired[2]) omp_unset_lock(&locks[(x + 1 + L) % L][y]);
@@ -136,8 +206,10 @@ int locking_metropolis(int **lattice, int L, double T, int x, int y, omp_lock_t
     int locked = 0;
 
     // Try acquiring the lock until timeout
+    TRACE_BEGIN("lock_wait");
     while (!locked) {
       if (omp_get_wtime() - start_time > timeout) {
+	COUNT(COUNTER_LOCK_TIMEOUTS);
 	break;  // Timeout reached, exit loop and continue to next iteration
       }
 
@@ -146,6 +218,7 @@ int locking_metropolis(int **lattice, int L, double T, int x, int y, omp_lock_t
         locked = 1;  // Lock acquired successfully
       }
     }
+    TRACE_END();
 
     if(locked){
       metropolis(lattice, L, T, x, y);
@@ -164,12 +237,11 @@ int locking_metropolis(int **lattice, int L, double T, int x, int y, omp_lock_t
 }
 
 //for data parallelism, only lock on boundaries of sublattice to save time
-int boundary_metropolis(int **lattice, int L, double T, int i_bound, int i_block_size, int j_bound, int j_block_size, unsigned int seed, omp_lock_t **locks){
-  //int i = random_int(i_bound, i_bound + i_block_size - 1);
-  //int j = random_int(j_bound, j_bound + j_block_size - 1);
-  //seed unique based on region -- unique to each thread
-  int i = (rand_r(&seed) % (i_block_size)) + i_bound;
-  int j = (rand_r(&seed) % j_block_size) + j_bound;
+int boundary_metropolis(int **lattice, int L, double T, int i_bound, int i_block_size, int j_bound, int j_block_size, omp_lock_t **locks){
+  //each thread draws from its own stream, so sites are unique to the thread's region
+  rng_stream_t *rng = rng_thread();
+  int i = rng_bounded(rng, i_block_size) + i_bound;
+  int j = rng_bounded(rng, j_block_size) + j_bound;
 
   int iBoundTest = (i - i_bound) % (i_block_size-1);
 
@@ -202,12 +274,11 @@ int collisionTest(int **workingSites, int L, int i, int j){
 //ignore locks altogether -- lets use a signaling array to avoid collisions and not wait for locks
 //data parallel approach without locks
 //assumption; lattice has been split into row major strips using i_bound and j_bound
-int signal_metropolis(int **lattice, int L, double T, int i_bound, int i_block_size, int j_bound, int j_block_size, unsigned int seed, int **workingSites){
+int signal_metropolis(int **lattice, int L, double T, int i_bound, int i_block_size, int j_bound, int j_block_size, int **workingSites){
   //printf("Debug: Signal Metropolis\n\n");
-  seed += microtime();
-  int i = (rand_r(&seed) % i_block_size) + i_bound;
-  seed += microtime();
-  int j = (rand_r(&seed) % j_block_size);
+  rng_stream_t *rng = rng_thread();
+  int i = rng_bounded(rng, i_block_size) + i_bound;
+  int j = rng_bounded(rng, j_block_size);
   //printf("I: %d J: %d\n\n",i,j);
   int iBoundTest = (i - i_bound) % (i_block_size - 1);
 
@@ -216,14 +287,17 @@ int signal_metropolis(int **lattice, int L, double T, int i_bound, int i_block_s
   //if on vertical boundary of strip, make sure no other threads are looking at same data
   if(iBoundTest == 0){
 //critically, check if any threads are working vertically adjacent
+    TRACE_BEGIN("critical");
 #pragma omp critical
 {
     //look in the working array for adjacency. Since we are in strips for data parallel, only consider vertical adjacency
     if(collisionTest(workingSites, L, i, j) == 1){
+      COUNT(COUNTER_SIGNAL_COLLISIONS);
       workingSites[i][j] = 1;
       locked = 1;
     }
 }  
+    TRACE_END();
 
   //now 'locked' we can complete metropolis step without fear of interference
   if(locked){
@@ -231,10 +305,12 @@ int signal_metropolis(int **lattice, int L, double T, int i_bound, int i_block_s
   }
   
   //release work site after completion of metropolis step
+  TRACE_BEGIN("critical");
 #pragma omp critical
 {
   workingSites[i][j] = 0;
 }
+  TRACE_END();
 
   }else{
     //if not on boundary, not in danger of collision -- freely apply
@@ -268,13 +344,15 @@ void ising_openmp_signalparallel(int **lattice, int L, double T, int steps, int
     int thread_id = omp_get_thread_num();
     int j_bound = 0;
     int i_bound = (thread_id * blockdim_i);
-    printf("Thread %d: i_bound = %d, blockdim_i = %d\n", thread_id, i_bound, blockdim_i);
+    //printf("Thread %d: i_bound = %d, blockdim_i = %d\n", thread_id, i_bound, blockdim_i);
 
     for (int i = 0; i < steps; i++){
-      int thread_id = omp_get_thread_num();
-      unsigned int seed = i + thread_id;
-      signal_metropolis(lattice,L,T,i_bound,blockdim_i,j_bound,blockdim_j,seed,workingSites);
+      TRACE_BEGIN("step");
+      signal_metropolis(lattice,L,T,i_bound,blockdim_i,j_bound,blockdim_j,workingSites);
+      TRACE_END();
+      TRACE_BEGIN("barrier");
       #pragma omp barrier
+      TRACE_END();
     }
   }
   //printf("Debug: end of parallel block\n");
@@ -286,3 +364,35 @@ void ising_openmp_signalparallel(int **lattice, int L, double T, int steps, int
 
 }
 
+
+//convert a run of single-site updates into equivalent Monte Carlo sweeps (L*L updates) per second
+//so random-site and ordered engines can be compared directly
+double sweeps_per_second(int L, int steps, double time_us){
+  if(time_us <= 0) return 0;
+  double sweeps = (double)steps / ((double)L * L);
+  return sweeps / (time_us * 1e-6);
+}
+
+//total energy with J = 1 and periodic boundaries; each bond counted once via the right and down neighbor
+long lattice_energy(int **lattice, int L){
+  long energy = 0;
+  for(int i = 0; i < L; i++){
+    int *row = lattice[i];
+    int *down = lattice[(i + 1) % L];
+    for(int j = 0; j < L; j++){
+      energy -= row[j] * (row[(j + 1) % L] + down[j]);
+    }
+  }
+  return energy;
+}
+
+//sum of all spins
+long lattice_magnetization(int **lattice, int L){
+  long magnetization = 0;
+  for(int i = 0; i < L; i++){
+    for(int j = 0; j < L; j++){
+      magnetization += lattice[i][j];
+    }
+  }
+  return magnetization;
+}
@@ -4,15 +4,21 @@
 #include <omp.h>
 
 void initialize_lattice(int **lattice, int L);
+void initialize_lattice_fixed(int **lattice, int L, long up);
 void print_lattice(int **lattice, int L);
 int random_int(int min, int max);
 double random_double();
+double flip_probability(int deltaE, double T);
+void flip_table(double T, double *table);
 void metropolis(int **lattice, int L, double T, int x, int y);
 void serial_metropolis(int **lattice, int L, double T, int steps);
 void naive_metropolis(int **lattice, int L, double T, int steps, int num_threads);
 int locking_metropolis(int **lattice, int L, double T, int x, int y, omp_lock_t **locks);
-int boundary_metropolis(int **lattice, int L, double T, int i_bound, int i_blocksize, int j_bound, int j_blocksize, unsigned int seed, omp_lock_t **locks);
-int signal_metropolis(int **lattice, int L, double T, int i_bound, int i_blocksize, int j_bound, int j_blocksize, unsigned int seed, int **workSites);
+int boundary_metropolis(int **lattice, int L, double T, int i_bound, int i_blocksize, int j_bound, int j_blocksize, omp_lock_t **locks);
+int signal_metropolis(int **lattice, int L, double T, int i_bound, int i_blocksize, int j_bound, int j_blocksize, int **workSites);
 void ising_openmp_signalparallel(int **lattice, int L, double T, int steps, int num_threads);
+double sweeps_per_second(int L, int steps, double time_us);
+long lattice_energy(int **lattice, int L);
+long lattice_magnetization(int **lattice, int L);
 
 #endif
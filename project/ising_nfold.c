@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <math.h>
+#include "ising_model.h"
+#include "ising_nfold.h"
+#include "ising_rng.h"
+#include "ising_counters.h"
+
+//sites grouped by local field class. class c holds the sites whose flip costs deltaE = 4c - 8, so every site in
+//a class flips with the same probability. members[c*N .. c*N+count[c]) lists them; pos[] is each site's slot
+//there, which makes moving a site between classes O(1)
+typedef struct {
+  int L;
+  int N;
+  signed char *spin;
+  unsigned char *cls;
+  int *pos;
+  int *members;
+  int count[5];
+} nfold_state_t;
+
+static inline int site_class(const nfold_state_t *st, int site){
+  int L = st->L;
+  int x = site / L, y = site % L;
+  int sum_neighbors = st->spin[((x + 1) % L) * L + y] + st->spin[((x - 1 + L) % L) * L + y] +
+                      st->spin[x * L + (y + 1) % L] + st->spin[x * L + (y - 1 + L) % L];
+  int deltaE = 2 * st->spin[site] * sum_neighbors;
+  return (deltaE + 8) >> 2;
+}
+
+static inline void bucket_add(nfold_state_t *st, int site, int c){
+  st->cls[site] = c;
+  st->pos[site] = st->count[c];
+  st->members[c * st->N + st->count[c]++] = site;
+}
+
+//swap-remove: the last member of the class takes the vacated slot
+static inline void bucket_remove(nfold_state_t *st, int site){
+  int c = st->cls[site];
+  int last = st->members[c * st->N + --st->count[c]];
+  st->members[c * st->N + st->pos[site]] = last;
+  st->pos[last] = st->pos[site];
+}
+
+static inline void reclassify(nfold_state_t *st, int site){
+  int c = site_class(st, site);
+  if(c != st->cls[site]){
+    bucket_remove(st, site);
+    bucket_add(st, site, c);
+  }
+}
+
+//rejection-free (n-fold way / BKL) equivalent of serial_metropolis. instead of proposing random sites and mostly
+//rejecting them at low T, it picks a flip that will happen with probability proportional to its class rate and
+//advances simulated time by the geometric number of random-site attempts that flip would have taken.
+//'steps' is measured in those simulated attempts, so it means the same as for the other engines.
+//returns the number of spins flipped
+long nfold_metropolis(int **lattice, int L, double T, int steps){
+  nfold_state_t st;
+  st.L = L;
+  st.N = L * L;
+  st.spin = (signed char *)malloc(st.N);
+  st.cls = (unsigned char *)malloc(st.N);
+  st.pos = (int *)malloc(st.N * sizeof(int));
+  st.members = (int *)malloc(5 * (size_t)st.N * sizeof(int));
+  for(int c = 0; c < 5; c++){
+    st.count[c] = 0;
+  }
+
+  for(int x = 0; x < L; x++){
+    for(int y = 0; y < L; y++){
+      st.spin[x * L + y] = lattice[x][y];
+    }
+  }
+  for(int site = 0; site < st.N; site++){
+    bucket_add(&st, site, site_class(&st, site));
+  }
+
+  double rate[5];
+  flip_table(T, rate);
+  rng_stream_t *rng = rng_thread();
+  double time = 0;
+  long flips = 0;
+
+  for(;;){
+    double weights[5];
+    double total = 0;
+    for(int c = 0; c < 5; c++){
+      weights[c] = st.count[c] * rate[c];
+      total += weights[c];
+    }
+    //frozen: no site can ever flip (T = 0 ground state)
+    if(total <= 0) break;
+
+    //each random-site attempt flips with probability total/N, so the wait is geometric
+    double p_flip = total / st.N;
+    double wait = 1;
+    if(p_flip < 1){
+      wait = ceil(log(1.0 - rng_uniform(rng)) / log1p(-p_flip));
+      if(wait < 1) wait = 1;
+    }
+    if(time + wait > steps) break;
+    time += wait;
+    COUNT_ADD(COUNTER_ATTEMPTS, (unsigned long)wait);
+
+    //class with probability weights[c]/total, then a uniform member of it
+    //(rounding can leave r just past the end; it then stays on the last class that can flip)
+    double r = rng_uniform(rng) * total;
+    int c = -1;
+    for(int k = 0; k < 5; k++){
+      if(weights[k] <= 0) continue;
+      c = k;
+      if(r < weights[k]) break;
+      r -= weights[k];
+    }
+    int site = st.members[c * st.N + rng_bounded(rng, st.count[c])];
+
+    st.spin[site] = -st.spin[site];
+    flips++;
+    COUNT(COUNTER_ACCEPTS);
+
+    int x = site / L, y = site % L;
+    reclassify(&st, site);
+    reclassify(&st, ((x + 1) % L) * L + y);
+    reclassify(&st, ((x - 1 + L) % L) * L + y);
+    reclassify(&st, x * L + (y + 1) % L);
+    reclassify(&st, x * L + (y - 1 + L) % L);
+  }
+
+  for(int x = 0; x < L; x++){
+    for(int y = 0; y < L; y++){
+      lattice[x][y] = st.spin[x * L + y];
+    }
+  }
+  free(st.spin);
+  free(st.cls);
+  free(st.pos);
+  free(st.members);
+  return flips;
+}
@@ -0,0 +1,5 @@
+#ifndef ISING_NFOLD_H
+#define ISING_NFOLD_H
+
+long nfold_metropolis(int **lattice, int L, double T, int steps);
+#endif
@@ -2,6 +2,7 @@
 #include <omp.h>
 #include <stdlib.h>
 #include "ising_model.h"
+#include "ising_trace.h"
 
 //parallelize the calculation by dividing matrix into submatrices; then, locking and unlocking only occur on boundary
 //Will have interesting topology on problem size -- 'surface to volume' ratio
@@ -33,10 +34,11 @@ void ising_openmp_dataparallel(int **lattice, int L, double T, int steps, int nu
     int i_bound = (thread_id * blockdim_i) % L;
     
     //evenly divide work
+    TRACE_BEGIN("strip");
     for (int i = 0; i < steps/num_threads; i++){
-      unsigned int seed = i + omp_get_thread_num();
-      boundary_metropolis(lattice,L,T,i_bound,blockdim_i,j_bound,blockdim_j,seed,locks);
+      boundary_metropolis(lattice,L,T,i_bound,blockdim_i,j_bound,blockdim_j,locks);
     }
+    TRACE_END();
   }
 
   //Clean up locks and memory
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "ising_model.h"
+#include "ising_potts.h"
+#include "ising_rng.h"
+#include "ising_counters.h"
+
+//one specialized copy of the kernels per q
+#define POTTS_Q 2
+#include "ising_potts_impl.h"
+#define POTTS_Q 3
+#include "ising_potts_impl.h"
+#define POTTS_Q 4
+#include "ising_potts_impl.h"
+#define POTTS_Q 5
+#include "ising_potts_impl.h"
+#define POTTS_Q 6
+#include "ising_potts_impl.h"
+#define POTTS_Q 7
+#include "ising_potts_impl.h"
+#define POTTS_Q 8
+#include "ising_potts_impl.h"
+
+typedef long (*potts_serial_fn)(potts_lattice_t *p, const double *table, int steps);
+typedef long (*potts_checkerboard_fn)(potts_lattice_t *p, const double *table, int sweeps, int num_threads);
+
+//indexed by q - POTTS_MIN_Q
+static const potts_serial_fn serial_kernels[] = {
+  potts_serial_q2, potts_serial_q3, potts_serial_q4, potts_serial_q5, potts_serial_q6, potts_serial_q7, potts_serial_q8,
+};
+static const potts_checkerboard_fn checkerboard_kernels[] = {
+  potts_checkerboard_q2, potts_checkerboard_q3, potts_checkerboard_q4, potts_checkerboard_q5,
+  potts_checkerboard_q6, potts_checkerboard_q7, potts_checkerboard_q8,
+};
+
+//random start. returns -1 if q is out of range or allocation fails
+int potts_lattice_init(potts_lattice_t *p, int L, int q){
+  p->L = L;
+  p->q = q;
+  p->spins = NULL;
+  p->states = NULL;
+  if(q < POTTS_MIN_Q || q > POTTS_MAX_Q){
+    fprintf(stderr, "potts_lattice_init: q = %d outside %d..%d\n", q, POTTS_MIN_Q, POTTS_MAX_Q);
+    return -1;
+  }
+  rng_stream_t *rng = rng_thread();
+
+  if(q == 2){
+    p->spins = (int **)calloc(L, sizeof(int *));
+    if(p->spins == NULL) return -1;
+    for(int i = 0; i < L; i++){
+      p->spins[i] = (int *)malloc(L * sizeof(int));
+      if(p->spins[i] == NULL){
+        potts_lattice_free(p);
+        return -1;
+      }
+      for(int j = 0; j < L; j++){
+        p->spins[i][j] = rng_bounded(rng, 2) ? 1 : -1;
+      }
+    }
+  }else{
+    p->states = (unsigned char **)calloc(L, sizeof(unsigned char *));
+    if(p->states == NULL) return -1;
+    for(int i = 0; i < L; i++){
+      p->states[i] = (unsigned char *)malloc(L);
+      if(p->states[i] == NULL){
+        potts_lattice_free(p);
+        return -1;
+      }
+      for(int j = 0; j < L; j++){
+        p->states[i][j] = rng_bounded(rng, q);
+      }
+    }
+  }
+  return 0;
+}
+
+void potts_lattice_free(potts_lattice_t *p){
+  for(int i = 0; i < p->L; i++){
+    if(p->spins) free(p->spins[i]);
+    if(p->states) free(p->states[i]);
+  }
+  free(p->spins);
+  free(p->states);
+  p->spins = NULL;
+  p->states = NULL;
+}
+
+static inline int potts_state(const potts_lattice_t *p, int x, int y){
+  return p->spins ? (p->spins[x][y] > 0) : p->states[x][y];
+}
+
+//total energy, -(number of bonds joining equal states)
+long potts_energy(const potts_lattice_t *p){
+  int L = p->L;
+  long energy = 0;
+  for(int x = 0; x < L; x++){
+    for(int y = 0; y < L; y++){
+      int s = potts_state(p, x, y);
+      energy -= (s == potts_state(p, (x + 1) % L, y)) + (s == potts_state(p, x, (y + 1) % L));
+    }
+  }
+  return energy;
+}
+
+//(q * largest state fraction - 1) / (q - 1): 0 when disordered, 1 when fully ordered
+double potts_order_parameter(const potts_lattice_t *p){
+  int L = p->L;
+  long counts[POTTS_MAX_Q] = {0};
+  for(int x = 0; x < L; x++){
+    for(int y = 0; y < L; y++){
+      counts[potts_state(p, x, y)]++;
+    }
+  }
+  long largest = 0;
+  for(int s = 0; s < p->q; s++){
+    if(counts[s] > largest) largest = counts[s];
+  }
+  return (p->q * (double)largest / ((double)L * L) - 1) / (p->q - 1);
+}
+
+static void potts_table(double T, double *table){
+  for(int i = 0; i < 9; i++){
+    table[i] = flip_probability(i - 4, T);
+  }
+}
+
+//'steps' random-site updates. returns the number accepted
+long potts_metropolis(potts_lattice_t *p, double T, int steps){
+  double table[9];
+  potts_table(T, table);
+  return serial_kernels[p->q - POTTS_MIN_Q](p, table, steps);
+}
+
+//parallel checkerboard sweeps. L must be even. returns the number accepted, or -1 for odd L
+long potts_checkerboard(potts_lattice_t *p, double T, int sweeps, int num_threads){
+  if(p->L % 2 != 0){
+    fprintf(stderr, "potts_checkerboard: L = %d is odd\n", p->L);
+    return -1;
+  }
+  double table[9];
+  potts_table(T, table);
+  return checkerboard_kernels[p->q - POTTS_MIN_Q](p, table, sweeps, num_threads);
+}
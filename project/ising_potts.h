@@ -0,0 +1,23 @@
+#ifndef ISING_POTTS_H
+#define ISING_POTTS_H
+
+#define POTTS_MIN_Q 2
+#define POTTS_MAX_Q 8
+
+//q-state Potts lattice, E = -sum over bonds of delta(s_i, s_j). q = 2 keeps the int +-1 rows of the Ising engines
+//(spins), larger q stores states 0..q-1 one byte each (states); the other pointer is NULL
+typedef struct {
+  int L;
+  int q;
+  int **spins;
+  unsigned char **states;
+} potts_lattice_t;
+
+int potts_lattice_init(potts_lattice_t *p, int L, int q);
+void potts_lattice_free(potts_lattice_t *p);
+long potts_energy(const potts_lattice_t *p);
+double potts_order_parameter(const potts_lattice_t *p);
+long potts_metropolis(potts_lattice_t *p, double T, int steps);
+long potts_checkerboard(potts_lattice_t *p, double T, int sweeps, int num_threads);
+
+#endif
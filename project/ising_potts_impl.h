@@ -0,0 +1,88 @@
+//kernel template for one q, included once per q by ising_potts.c with POTTS_Q defined. no include guard on purpose.
+//q is a compile-time constant here, so the proposal range and the table stay constants and nothing loops over q.
+//q = 2 instantiates the Ising kernel itself: int +-1 spins where delta(s, s') = (1 + s s') / 2, so flipping costs
+//s * (sum of neighbors) in Potts units
+#ifndef POTTS_Q
+#error "define POTTS_Q before including ising_potts_impl.h"
+#endif
+
+#define POTTS_PASTE_(name, q) name##_q##q
+#define POTTS_PASTE(name, q) POTTS_PASTE_(name, q)
+#define POTTS_FN(name) POTTS_PASTE(name, POTTS_Q)
+
+#if POTTS_Q == 2
+#define POTTS_SPIN int
+#define POTTS_ROWS(p) ((p)->spins)
+#else
+#define POTTS_SPIN unsigned char
+#define POTTS_ROWS(p) ((p)->states)
+#endif
+
+//heat-bath update of one site. table[deltaE + 4] is the acceptance for deltaE = -4..4
+static inline int POTTS_FN(potts_update)(POTTS_SPIN **lattice, int L, int x, int y, const double *table, rng_stream_t *rng){
+  POTTS_SPIN *row = lattice[x];
+  POTTS_SPIN up = lattice[(x == 0) ? L - 1 : x - 1][y];
+  POTTS_SPIN down = lattice[(x == L - 1) ? 0 : x + 1][y];
+  POTTS_SPIN left = row[(y == 0) ? L - 1 : y - 1];
+  POTTS_SPIN right = row[(y == L - 1) ? 0 : y + 1];
+  POTTS_SPIN s = row[y];
+  COUNT(COUNTER_ATTEMPTS);
+#if POTTS_Q == 2
+  int deltaE = s * (up + down + left + right);
+  POTTS_SPIN proposed = -s;
+#else
+  //uniform over the q-1 other states
+  POTTS_SPIN proposed = rng_bounded(rng, POTTS_Q - 1);
+  proposed += (proposed >= s);
+  int deltaE = ((up == s) + (down == s) + (left == s) + (right == s)) -
+               ((up == proposed) + (down == proposed) + (left == proposed) + (right == proposed));
+#endif
+  if(rng_uniform(rng) < table[deltaE + 4]){
+    row[y] = proposed;
+    COUNT(COUNTER_ACCEPTS);
+    return 1;
+  }
+  return 0;
+}
+
+//'steps' updates of random sites, the Potts counterpart of serial_metropolis
+static long POTTS_FN(potts_serial)(potts_lattice_t *p, const double *table, int steps){
+  POTTS_SPIN **lattice = POTTS_ROWS(p);
+  int L = p->L;
+  rng_stream_t *rng = rng_thread();
+  long accepted = 0;
+  for(int i = 0; i < steps; i++){
+    int x = rng_bounded(rng, L);
+    int y = rng_bounded(rng, L);
+    accepted += POTTS_FN(potts_update)(lattice, L, x, y, table, rng);
+  }
+  return accepted;
+}
+
+//checkerboard sweeps, one color per parallel half-sweep as in checkerboard_metropolis. L must be even
+static long POTTS_FN(potts_checkerboard)(potts_lattice_t *p, const double *table, int sweeps, int num_threads){
+  POTTS_SPIN **lattice = POTTS_ROWS(p);
+  int L = p->L;
+  long accepted = 0;
+
+  #pragma omp parallel num_threads(num_threads) reduction(+:accepted)
+  {
+    rng_stream_t *rng = rng_thread();
+    for(int s = 0; s < 2 * sweeps; s++){
+      #pragma omp for schedule(static)
+      for(int x = 0; x < L; x++){
+        for(int y = (x + s) & 1; y < L; y += 2){
+          accepted += POTTS_FN(potts_update)(lattice, L, x, y, table, rng);
+        }
+      }
+    }
+  }
+  return accepted;
+}
+
+#undef POTTS_SPIN
+#undef POTTS_ROWS
+#undef POTTS_FN
+#undef POTTS_PASTE
+#undef POTTS_PASTE_
+#undef POTTS_Q
@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <math.h>
+#include "ising_model.h"
+#include "ising_reweight.h"
+
+//Ferrenberg-Swendsen iteration stops once no ln Z moves more than this, or after REWEIGHT_MAX_ITER rounds
+#define REWEIGHT_TOLERANCE 1e-10
+#define REWEIGHT_MAX_ITER 100000
+
+//returns 0 on success, -1 if allocation failed
+int histogram_init(ising_histogram_t *h, int L, double T){
+  h->L = L;
+  h->N = (long)L * L;
+  h->T = T;
+  h->samples = 0;
+  h->counts = (long *)calloc(h->N + 1, sizeof(long));
+  h->sum_abs_m = (double *)calloc(h->N + 1, sizeof(double));
+  h->sum_m2 = (double *)calloc(h->N + 1, sizeof(double));
+  h->sum_m4 = (double *)calloc(h->N + 1, sizeof(double));
+  if(h->counts == NULL || h->sum_abs_m == NULL || h->sum_m2 == NULL || h->sum_m4 == NULL){
+    histogram_free(h);
+    return -1;
+  }
+  return 0;
+}
+
+void histogram_free(ising_histogram_t *h){
+  free(h->counts);
+  free(h->sum_abs_m);
+  free(h->sum_m2);
+  free(h->sum_m4);
+  h->counts = NULL;
+  h->sum_abs_m = h->sum_m2 = h->sum_m4 = NULL;
+}
+
+//energy of bin k
+static inline double bin_energy(const ising_histogram_t *h, long k){
+  return -2.0 * h->N + 4.0 * k;
+}
+
+//add the current configuration to the histogram
+void histogram_record(ising_histogram_t *h, int **lattice){
+  long k = (lattice_energy(lattice, h->L) + 2 * h->N) / 4;
+  double m = (double)lattice_magnetization(lattice, h->L) / h->N;
+  h->counts[k]++;
+  h->sum_abs_m[k] += fabs(m);
+  h->sum_m2[k] += m * m;
+  h->sum_m4[k] += m * m * m * m;
+  h->samples++;
+}
+
+//production run: 'samples' measurements, sweeps_between sweeps of the given engine before each one.
+//the lattice should already be equilibrated at h->T
+void histogram_sample(ising_histogram_t *h, int **lattice, ising_engine_t engine, int num_threads, int block_size,
+                      int sweeps_between, long samples){
+  int steps = sweeps_between * h->L * h->L;
+  for(long s = 0; s < samples; s++){
+    run_engine(engine, lattice, h->L, h->T, steps, num_threads, block_size);
+    histogram_record(h, lattice);
+  }
+}
+
+//log(sum(exp(x))) without overflow, accumulated one term at a time
+static inline double log_add(double a, double b){
+  if(a == -INFINITY) return b;
+  if(b == -INFINITY) return a;
+  return (a > b) ? a + log1p(exp(b - a)) : b + log1p(exp(a - b));
+}
+
+//ln of the density of states at bin k given the current ln Z of every run, or -INFINITY if no run visited the bin
+static double log_density(const ising_histogram_t *runs, int n_runs, const double *f, long k){
+  long total = 0;
+  double denominator = -INFINITY;
+  double E = bin_energy(&runs[0], k);
+  for(int j = 0; j < n_runs; j++){
+    total += runs[j].counts[k];
+    if(runs[j].samples > 0){
+      denominator = log_add(denominator, log((double)runs[j].samples) - E / runs[j].T - f[j]);
+    }
+  }
+  if(total == 0) return -INFINITY;
+  return log((double)total) - denominator;
+}
+
+//solve the multi-histogram equations for f[i] = ln Z(T_i), normalized so f[0] = 0.
+//all runs must share L. returns the number of iterations, or -1 if it did not converge
+int reweight_free_energies(const ising_histogram_t *runs, int n_runs, double *f){
+  long N = runs[0].N;
+  double *log_g = (double *)malloc((N + 1) * sizeof(double));
+  double *f_new = (double *)malloc(n_runs * sizeof(double));
+  int iterations = -1;
+
+  for(int i = 0; i < n_runs; i++){
+    f[i] = 0;
+  }
+
+  for(int iter = 1; iter <= REWEIGHT_MAX_ITER; iter++){
+    for(long k = 0; k <= N; k++){
+      log_g[k] = log_density(runs, n_runs, f, k);
+    }
+    for(int i = 0; i < n_runs; i++){
+      f_new[i] = -INFINITY;
+      for(long k = 0; k <= N; k++){
+        if(log_g[k] == -INFINITY) continue;
+        f_new[i] = log_add(f_new[i], log_g[k] - bin_energy(&runs[0], k) / runs[i].T);
+      }
+    }
+
+    double change = 0;
+    for(int i = 0; i < n_runs; i++){
+      double next = f_new[i] - f_new[0];
+      change = fmax(change, fabs(next - f[i]));
+      f[i] = next;
+    }
+    if(change < REWEIGHT_TOLERANCE){
+      iterations = iter;
+      break;
+    }
+  }
+
+  free(log_g);
+  free(f_new);
+  return iterations;
+}
+
+//observables per site at temperature T from the combined histograms. only trustworthy inside (or just outside)
+//the range of temperatures that were simulated, where the histograms overlap
+void reweight_point(const ising_histogram_t *runs, int n_runs, const double *f, double T, reweight_point_t *point){
+  long N = runs[0].N;
+  double *log_w = (double *)malloc((N + 1) * sizeof(double));
+  double log_max = -INFINITY;
+
+  for(long k = 0; k <= N; k++){
+    double log_g = log_density(runs, n_runs, f, k);
+    log_w[k] = (log_g == -INFINITY) ? -INFINITY : log_g - bin_energy(&runs[0], k) / T;
+    log_max = fmax(log_max, log_w[k]);
+  }
+
+  double norm = 0, E_mean = 0, abs_m = 0, m2 = 0, m4 = 0;
+  for(long k = 0; k <= N; k++){
+    if(log_w[k] == -INFINITY) continue;
+    double p = exp(log_w[k] - log_max);
+    long count = 0;
+    double bin_abs_m = 0, bin_m2 = 0, bin_m4 = 0;
+    for(int j = 0; j < n_runs; j++){
+      count += runs[j].counts[k];
+      bin_abs_m += runs[j].sum_abs_m[k];
+      bin_m2 += runs[j].sum_m2[k];
+      bin_m4 += runs[j].sum_m4[k];
+    }
+    norm += p;
+    E_mean += p * bin_energy(&runs[0], k);
+    abs_m += p * bin_abs_m / count;
+    m2 += p * bin_m2 / count;
+    m4 += p * bin_m4 / count;
+  }
+  E_mean /= norm;
+  abs_m /= norm;
+  m2 /= norm;
+  m4 /= norm;
+
+  double E_var = 0;
+  for(long k = 0; k <= N; k++){
+    if(log_w[k] == -INFINITY) continue;
+    double dE = bin_energy(&runs[0], k) - E_mean;
+    E_var += exp(log_w[k] - log_max) * dE * dE;
+  }
+  E_var /= norm;
+
+  point->T = T;
+  point->energy = E_mean / N;
+  point->specific_heat = E_var / (T * T * N);
+  point->abs_magnetization = abs_m;
+  point->susceptibility = N * (m2 - abs_m * abs_m) / T;
+  point->binder = (m2 > 0) ? 1.0 - m4 / (3.0 * m2 * m2) : 0;
+
+  free(log_w);
+}
+
+//E(T), C(T), |m|(T), chi(T) and Binder cumulant on 'points' evenly spaced temperatures, as csv
+void reweight_curve(const ising_histogram_t *runs, int n_runs, double T_lo, double T_hi, int points, FILE *file){
+  double *f = (double *)malloc(n_runs * sizeof(double));
+  if(reweight_free_energies(runs, n_runs, f) < 0){
+    fprintf(stderr, "Multi-histogram iteration did not converge; histograms may not overlap\n");
+  }
+
+  fprintf(file, "T,Energy,SpecificHeat,AbsMagnetization,Susceptibility,Binder\n");
+  for(int p = 0; p < points; p++){
+    double T = (points > 1) ? T_lo + (T_hi - T_lo) * p / (points - 1) : T_lo;
+    reweight_point_t point;
+    reweight_point(runs, n_runs, f, T, &point);
+    fprintf(file, "%f,%f,%f,%f,%f,%f\n", point.T, point.energy, point.specific_heat,
+            point.abs_magnetization, point.susceptibility, point.binder);
+  }
+  free(f);
+}
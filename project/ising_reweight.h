@@ -0,0 +1,41 @@
+#ifndef ISING_REWEIGHT_H
+#define ISING_REWEIGHT_H
+
+#include <stdio.h>
+#include "ising_engines.h"
+
+//production histogram of one run at temperature T. energies of an LxL periodic lattice are E = -2N + 4k, k = 0..N,
+//so bin k holds the number of samples at that energy together with the sums of |m|, m^2 and m^4 (per site) over
+//those samples. that is the joint E/M histogram collapsed onto the magnetization moments we reweight, at O(N)
+//memory instead of O(N^2)
+typedef struct {
+  int L;
+  long N;
+  double T;
+  long samples;
+  long *counts;
+  double *sum_abs_m;
+  double *sum_m2;
+  double *sum_m4;
+} ising_histogram_t;
+
+//observables per site at one temperature
+typedef struct {
+  double T;
+  double energy;
+  double specific_heat;
+  double abs_magnetization;
+  double susceptibility;
+  double binder;
+} reweight_point_t;
+
+int histogram_init(ising_histogram_t *h, int L, double T);
+void histogram_free(ising_histogram_t *h);
+void histogram_record(ising_histogram_t *h, int **lattice);
+void histogram_sample(ising_histogram_t *h, int **lattice, ising_engine_t engine, int num_threads, int block_size,
+                      int sweeps_between, long samples);
+int reweight_free_energies(const ising_histogram_t *runs, int n_runs, double *f);
+void reweight_point(const ising_histogram_t *runs, int n_runs, const double *f, double T, reweight_point_t *point);
+void reweight_curve(const ising_histogram_t *runs, int n_runs, double T_lo, double T_hi, int points, FILE *file);
+
+#endif
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+#include "ising_rng.h"
+
+typedef uint64_t rng_wide_t __attribute__((vector_size(RNG_LANES * sizeof(uint64_t))));
+typedef double rng_dvec_t __attribute__((vector_size(RNG_LANES * sizeof(double))));
+
+static rng_stream_t rng_streams[RNG_MAX_THREADS];
+
+//splitmix64; only used to expand a single seed into well mixed lane states
+static uint64_t splitmix64(uint64_t *x){
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+//leave the upper vector halves clean before returning to scalar/SSE code such as libm's exp().
+//gcc only inserts vzeroupper itself when optimizing, and the transition penalty otherwise costs more than the RNG
+static inline void rng_vector_done(void){
+#ifdef __AVX__
+  _mm256_zeroupper();
+#endif
+}
+
+static inline rng_vec_t rotl(rng_vec_t v, int k){
+  return (v << k) | (v >> (32 - k));
+}
+
+//advance all lanes one xoshiro128** step. plain vector arithmetic, so the compiler emits SIMD
+static inline rng_vec_t rng_next_vec(rng_vec_t *s){
+  rng_vec_t result = rotl(s[1] * 5, 7) * 9;
+  rng_vec_t t = s[1] << 9;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 11);
+
+  return result;
+}
+
+void rng_seed(rng_stream_t *rng, uint64_t seed){
+  for(int w = 0; w < 4; w++){
+    for(int lane = 0; lane < RNG_LANES; lane++){
+      rng->state[w][lane] = (uint32_t)splitmix64(&seed);
+    }
+  }
+  //xoshiro state must not be all zero; splitmix output makes that practically impossible but guard lane 0 anyway
+  if(rng->state[0][0] == 0 && rng->state[1][0] == 0 && rng->state[2][0] == 0 && rng->state[3][0] == 0){
+    rng->state[0][0] = 1;
+  }
+  //force a refill on first use
+  rng->pos = RNG_BUFFER_SIZE;
+  rng->seeded = 1;
+}
+
+//seed every per-thread stream from one base seed; stream i gets its own splitmix sequence
+void rng_seed_all(uint64_t seed){
+  for(int i = 0; i < RNG_MAX_THREADS; i++){
+    rng_seed(&rng_streams[i], seed + 0x632be59bd9b4e019ULL * (uint64_t)i);
+  }
+}
+
+//regenerate the whole buffer, RNG_LANES values per vector step
+void rng_refill(rng_stream_t *rng){
+  rng_vec_t *out = (rng_vec_t *)rng->buffer;
+  for(int i = 0; i < RNG_BUFFER_SIZE / RNG_LANES; i++){
+    out[i] = rng_next_vec(rng->state);
+  }
+  rng->pos = 0;
+  rng_vector_done();
+}
+
+//stream owned by the calling OpenMP thread. streams that were never seeded get a fixed per-thread seed
+rng_stream_t *rng_thread(void){
+  int thread_id = omp_get_thread_num();
+  if(thread_id >= RNG_MAX_THREADS){
+    fprintf(stderr, "Thread %d exceeds RNG_MAX_THREADS (%d)\n", thread_id, RNG_MAX_THREADS);
+    exit(EXIT_FAILURE);
+  }
+  rng_stream_t *rng = &rng_streams[thread_id];
+  if(!rng->seeded){
+    rng_seed(rng, 42 + thread_id);
+  }
+  return rng;
+}
+
+//fill out[0..n) with integers in [0, range) a vector at a time, straight from the generator state.
+//values still sitting in the buffer stay valid since the state only moves forward
+void rng_fill_bounded(rng_stream_t *rng, int *out, int n, uint32_t range){
+  int i = 0;
+  for(; i + RNG_LANES <= n; i += RNG_LANES){
+    rng_wide_t wide = __builtin_convertvector(rng_next_vec(rng->state), rng_wide_t);
+    rng_vec_t bounded = __builtin_convertvector((wide * range) >> 32, rng_vec_t);
+    memcpy(&out[i], &bounded, sizeof(bounded));
+  }
+  rng_vector_done();
+  for(; i < n; i++){
+    out[i] = (int)rng_bounded(rng, range);
+  }
+}
+
+//fill out[0..n) with doubles in [0, 1)
+void rng_fill_uniform(rng_stream_t *rng, double *out, int n){
+  int i = 0;
+  for(; i + RNG_LANES <= n; i += RNG_LANES){
+    rng_dvec_t u = __builtin_convertvector(rng_next_vec(rng->state), rng_dvec_t) * (1.0 / 4294967296.0);
+    memcpy(&out[i], &u, sizeof(u));
+  }
+  rng_vector_done();
+  for(; i < n; i++){
+    out[i] = rng_uniform(rng);
+  }
+}
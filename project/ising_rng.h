@@ -0,0 +1,49 @@
+#ifndef ISING_RNG_H
+#define ISING_RNG_H
+
+#include <stdint.h>
+
+//independent xoshiro128** generators advanced together in one vector register
+#define RNG_LANES 16
+//raw 32 bit values produced per refill; must be a multiple of RNG_LANES
+#define RNG_BUFFER_SIZE 4096
+//one stream per OpenMP thread id
+#define RNG_MAX_THREADS 256
+
+typedef uint32_t rng_vec_t __attribute__((vector_size(RNG_LANES * sizeof(uint32_t))));
+
+//per-thread stream: vectorized generator state plus a cache line aligned buffer of pre-generated values.
+//aligned so two threads' streams never share a cache line
+typedef struct {
+  rng_vec_t state[4];
+  uint32_t buffer[RNG_BUFFER_SIZE] __attribute__((aligned(64)));
+  int pos;
+  int seeded;
+} __attribute__((aligned(64))) rng_stream_t;
+
+void rng_seed(rng_stream_t *rng, uint64_t seed);
+void rng_seed_all(uint64_t seed);
+void rng_refill(rng_stream_t *rng);
+rng_stream_t *rng_thread(void);
+void rng_fill_bounded(rng_stream_t *rng, int *out, int n, uint32_t range);
+void rng_fill_uniform(rng_stream_t *rng, double *out, int n);
+
+//next raw 32 bit value; refills the whole buffer with SIMD when it runs dry
+static inline uint32_t rng_next(rng_stream_t *rng){
+  if(rng->pos == RNG_BUFFER_SIZE){
+    rng_refill(rng);
+  }
+  return rng->buffer[rng->pos++];
+}
+
+//integer in [0, range) by multiply-shift reduction instead of modulo
+static inline uint32_t rng_bounded(rng_stream_t *rng, uint32_t range){
+  return (uint32_t)(((uint64_t)rng_next(rng) * range) >> 32);
+}
+
+//double in [0, 1)
+static inline double rng_uniform(rng_stream_t *rng){
+  return rng_next(rng) * (1.0 / 4294967296.0);
+}
+
+#endif
@@ -0,0 +1,5 @@
+#ifndef ISING_SWEEP_H
+#define ISING_SWEEP_H
+
+void ordered_metropolis(int **lattice, int L, double T, int steps, int block_size);
+#endif
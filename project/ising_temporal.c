@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include <omp.h>
+#include "ising_model.h"
+#include "ising_temporal.h"
+#include "ising_sweep.h"
+#include "ising_rng.h"
+#include "ising_counters.h"
+#include "ising_trace.h"
+
+//tile height used when none is given
+#define TEMPORAL_DEFAULT_TILE 32
+//most half-sweeps a tile is advanced per pass; deeper passes shrink the useful part of each trapezoid
+#define TEMPORAL_MAX_DEPTH 8
+
+//checkerboard half-sweep of one row: update the sites of the given color, (x+y)%2 == color.
+//those only read neighbors of the other color, so rows of the same color level can be updated in any order
+static long update_row(int **lattice, int L, int x, int color, const double *table, rng_stream_t *rng){
+  x = (x % L + L) % L;
+  int *row = lattice[x];
+  int *up = lattice[(x == 0) ? L - 1 : x - 1];
+  int *down = lattice[(x == L - 1) ? 0 : x + 1];
+  long accepted = 0;
+
+  for(int y = (x + color) & 1; y < L; y += 2){
+    int left = (y == 0) ? L - 1 : y - 1;
+    int right = (y == L - 1) ? 0 : y + 1;
+    int sum_neighbors = up[y] + down[y] + row[left] + row[right];
+    int deltaE = 2 * row[y] * sum_neighbors;
+    COUNT(COUNTER_ATTEMPTS);
+    if(rng_uniform(rng) < table[(deltaE + 8) >> 2]){
+      row[y] = -row[y];
+      accepted++;
+      COUNT(COUNTER_ACCEPTS);
+    }
+  }
+  return accepted;
+}
+
+//plain parallel checkerboard: every sweep is two half-sweeps over all rows, one color each.
+//returns the number of accepted flips
+long checkerboard_metropolis(int **lattice, int L, double T, int sweeps, int num_threads){
+  //the checkerboard coloring only wraps around an even lattice
+  if(L % 2 != 0){
+    ordered_metropolis(lattice, L, T, sweeps * L * L, 0);
+    return 0;
+  }
+  double table[5];
+  flip_table(T, table);
+  long accepted = 0;
+
+  #pragma omp parallel num_threads(num_threads) reduction(+:accepted)
+  {
+    rng_stream_t *rng = rng_thread();
+    for(int s = 0; s < 2 * sweeps; s++){
+      TRACE_BEGIN("half_sweep");
+      #pragma omp for schedule(static) nowait
+      for(int x = 0; x < L; x++){
+        accepted += update_row(lattice, L, x, s & 1, table, rng);
+      }
+      TRACE_END();
+      TRACE_BEGIN("barrier");
+      #pragma omp barrier
+      TRACE_END();
+    }
+  }
+  return accepted;
+}
+
+//temporal blocking. the lattice is cut into row tiles that are each advanced 'depth' half-sweeps while they sit in
+//cache, instead of streaming the whole lattice once per half-sweep.
+//
+//row x at half-sweep level h needs rows x-1 and x+1 at level h-1 or h (updating in place, a neighbor that has
+//already moved on to level h only changed the other color). so:
+//  phase A, tiles in parallel: tile [a,b) updates rows [a+h-1, b-h+1) at level h = 1..depth, a shrinking trapezoid
+//          that never reads a row another tile is writing at a different level
+//  phase B, tile boundaries in parallel: around each boundary a the rows [a-h+1, a+h-1) left behind by the
+//          trapezoids are brought up to level h = 2..depth, an inverted trapezoid
+//afterwards every row is at level 'depth'. tiles must be at least 2*depth rows tall so the phase B regions of
+//neighboring boundaries never touch
+static long temporal_pass(int **lattice, int L, int num_tiles, int depth, int first_color, const double *table, int num_threads){
+  long accepted = 0;
+
+  #pragma omp parallel num_threads(num_threads) reduction(+:accepted)
+  {
+    rng_stream_t *rng = rng_thread();
+
+    TRACE_BEGIN("trapezoids");
+    #pragma omp for schedule(static) nowait
+    for(int t = 0; t < num_tiles; t++){
+      int a = (int)((long)t * L / num_tiles);
+      int b = (int)((long)(t + 1) * L / num_tiles);
+      for(int h = 1; h <= depth; h++){
+        int color = (first_color + h - 1) & 1;
+        for(int x = a + h - 1; x < b - h + 1; x++){
+          accepted += update_row(lattice, L, x, color, table, rng);
+        }
+      }
+    }
+    TRACE_END();
+
+    TRACE_BEGIN("barrier");
+    #pragma omp barrier
+    TRACE_END();
+
+    TRACE_BEGIN("inverted_trapezoids");
+    #pragma omp for schedule(static) nowait
+    for(int t = 0; t < num_tiles; t++){
+      int a = (int)((long)t * L / num_tiles);
+      for(int h = 2; h <= depth; h++){
+        int color = (first_color + h - 1) & 1;
+        for(int x = a - h + 1; x < a + h - 1; x++){
+          accepted += update_row(lattice, L, x, color, table, rng);
+        }
+      }
+    }
+    TRACE_END();
+  }
+  return accepted;
+}
+
+//checkerboard Metropolis with temporal blocking over row tiles of tile_rows rows, parallel across tiles.
+//'steps' single-site updates are rounded to whole half-sweeps. returns the number of accepted flips
+long temporal_metropolis(int **lattice, int L, double T, int steps, int num_threads, int tile_rows){
+  if(L % 2 != 0){
+    ordered_metropolis(lattice, L, T, steps, 0);
+    return 0;
+  }
+  if(tile_rows <= 0) tile_rows = TEMPORAL_DEFAULT_TILE;
+  if(tile_rows > L) tile_rows = L;
+  if(tile_rows < 2) tile_rows = 2;
+
+  int num_tiles = L / tile_rows;
+  //shortest tile decides the depth
+  int max_depth = (L / num_tiles) / 2;
+  if(max_depth > TEMPORAL_MAX_DEPTH) max_depth = TEMPORAL_MAX_DEPTH;
+
+  double table[5];
+  flip_table(T, table);
+
+  long half_sweeps = (2L * steps + (long)L * L / 2) / ((long)L * L);
+  if(half_sweeps == 0 && steps > 0) half_sweeps = 1;
+
+  long accepted = 0;
+  long done = 0;
+  while(done < half_sweeps){
+    int depth = (half_sweeps - done < max_depth) ? (int)(half_sweeps - done) : max_depth;
+    accepted += temporal_pass(lattice, L, num_tiles, depth, done & 1, table, num_threads);
+    done += depth;
+  }
+  return accepted;
+}
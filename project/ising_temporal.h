@@ -0,0 +1,6 @@
+#ifndef ISING_TEMPORAL_H
+#define ISING_TEMPORAL_H
+
+long checkerboard_metropolis(int **lattice, int L, double T, int sweeps, int num_threads);
+long temporal_metropolis(int **lattice, int L, double T, int steps, int num_threads, int tile_rows);
+#endif
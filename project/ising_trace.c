@@ -0,0 +1,99 @@
+#include "ising_trace.h"
+
+#ifdef ISING_TRACE
+#include <stdio.h>
+#include <stdlib.h>
+
+//one ring per thread, padded so threads never share a line of bookkeeping
+typedef struct {
+  trace_event_t *events;
+  unsigned long count;                    //spans ever recorded; the ring holds the last TRACE_RING_EVENTS
+  int depth;
+  const char *open_name[TRACE_MAX_DEPTH];
+  double open_start[TRACE_MAX_DEPTH];
+} __attribute__((aligned(64))) trace_ring_t;
+
+int trace_active = 0;
+static trace_ring_t rings[TRACE_MAX_THREADS];
+static const char *trace_path;
+static double trace_epoch;
+
+static inline double trace_now_us(void){
+  return (omp_get_wtime() - trace_epoch) * 1e6;
+}
+
+static inline trace_ring_t *trace_ring(void){
+  int tid = omp_get_thread_num();
+  return (tid < TRACE_MAX_THREADS) ? &rings[tid] : NULL;
+}
+
+void trace_begin(const char *name){
+  trace_ring_t *ring = trace_ring();
+  if(ring == NULL) return;
+  //spans nested deeper than the stack are dropped, and so are their ends
+  if(ring->depth < TRACE_MAX_DEPTH){
+    ring->open_name[ring->depth] = name;
+    ring->open_start[ring->depth] = trace_now_us();
+  }
+  ring->depth++;
+}
+
+void trace_end(void){
+  trace_ring_t *ring = trace_ring();
+  if(ring == NULL || ring->depth == 0) return;
+  ring->depth--;
+  if(ring->depth >= TRACE_MAX_DEPTH) return;
+
+  //first span on this thread allocates its ring
+  if(ring->events == NULL){
+    ring->events = (trace_event_t *)malloc(TRACE_RING_EVENTS * sizeof(trace_event_t));
+    if(ring->events == NULL) return;
+  }
+  trace_event_t *event = &ring->events[ring->count % TRACE_RING_EVENTS];
+  event->name = ring->open_name[ring->depth];
+  event->start_us = ring->open_start[ring->depth];
+  event->duration_us = trace_now_us() - event->start_us;
+  ring->count++;
+}
+
+//complete ("X") events in the order they finished, one track per thread
+static void trace_flush(void){
+  FILE *file = fopen(trace_path, "w");
+  if(file == NULL){
+    fprintf(stderr, "Could not write trace %s\n", trace_path);
+    return;
+  }
+  fprintf(file, "{\"traceEvents\":[\n");
+  int first = 1;
+  unsigned long dropped = 0;
+  for(int t = 0; t < TRACE_MAX_THREADS; t++){
+    trace_ring_t *ring = &rings[t];
+    if(ring->count == 0) continue;
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"omp thread %d\"}}",
+            first ? "" : ",\n", t, t);
+    first = 0;
+
+    unsigned long begin = (ring->count > TRACE_RING_EVENTS) ? ring->count - TRACE_RING_EVENTS : 0;
+    dropped += begin;
+    for(unsigned long i = begin; i < ring->count; i++){
+      trace_event_t *event = &ring->events[i % TRACE_RING_EVENTS];
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+              event->name, t, event->start_us, event->duration_us);
+    }
+    free(ring->events);
+    ring->events = NULL;
+  }
+  fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+  fclose(file);
+  if(dropped) fprintf(stderr, "Trace %s: ring buffers overwrote %lu early spans\n", trace_path, dropped);
+}
+
+//runs before main (and when libising.so is loaded): tracing is on only if ISING_TRACE_FILE names an output file
+__attribute__((constructor)) static void trace_init(void){
+  trace_path = getenv("ISING_TRACE_FILE");
+  if(trace_path == NULL || trace_path[0] == '\0') return;
+  trace_epoch = omp_get_wtime();
+  trace_active = 1;
+  atexit(trace_flush);
+}
+#endif
@@ -0,0 +1,32 @@
+#ifndef ISING_TRACE_H
+#define ISING_TRACE_H
+
+#include <omp.h>
+
+//per-thread timeline of named spans, written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) at exit.
+//build with 'make TRACE=1' and set ISING_TRACE_FILE to the output path; without the flag the macros compile to
+//nothing, and without the variable they return after one test.
+//each OpenMP thread appends only to its own ring, so recording takes no locks. a full ring overwrites its oldest
+//spans, keeping the end of the run
+#define TRACE_MAX_THREADS 256
+#define TRACE_RING_EVENTS 65536
+#define TRACE_MAX_DEPTH 16
+
+typedef struct {
+  const char *name;
+  double start_us;
+  double duration_us;
+} trace_event_t;
+
+#ifdef ISING_TRACE
+extern int trace_active;
+void trace_begin(const char *name);
+void trace_end(void);
+#define TRACE_BEGIN(name) do{ if(trace_active) trace_begin(name); }while(0)
+#define TRACE_END() do{ if(trace_active) trace_end(); }while(0)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+#endif
+
+#endif